@@ -0,0 +1,325 @@
+/*
+** v_2datlas.cpp
+** Packs small 2D textures onto shared pages
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <string.h>
+#include "v_2datlas.h"
+#include "tarray.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "bitmap.h"
+#include "image.h"
+#include "textures.h"
+#include "texturemanager.h"
+
+CVAR(Bool, ui_2datlas, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+namespace Atlas2D
+{
+
+enum
+{
+	PageSize = 512,
+	MaxPages = 8,
+	MaxEntrySize = 64,	// larger graphics are few per frame and would fill the pages too quickly.
+};
+
+struct FAtlasPart
+{
+	FImageSource *Image;
+	int X, Y;			// position of the image's first texel, the border excluded.
+};
+
+struct FAtlasShelf
+{
+	int Y, Height, Used;
+};
+
+struct FAtlasPage
+{
+	FGameTexture *Texture;
+	FImageSource *Image;
+	TArray<FAtlasPart> Parts;
+	TArray<FAtlasShelf> Shelves;
+	int Bottom;
+};
+
+struct FAtlasEntry
+{
+	FImageSource *Image;
+	int Page;			// -1 if the texture cannot be put on a page.
+	FVector4 Rect;
+};
+
+// This is never freed, because the texture manager still clears the atlas
+// while it gets destroyed at exit.
+struct FAtlasState
+{
+	TArray<FAtlasPage> Pages;
+	TMap<FGameTexture *, FAtlasEntry> Entries;
+};
+
+static FAtlasState *State;
+
+static FAtlasState *GetState()
+{
+	if (State == nullptr) State = new FAtlasState;
+	return State;
+}
+
+//==========================================================================
+//
+// The image of one page. Images may not hold any destructible data,
+// so the list of parts stays with the atlas.
+//
+// Every part gets a one texel border that repeats its edge, so that
+// filtering at the edges gives the same result as a clamped texture.
+//
+//==========================================================================
+
+class F2DAtlasImage : public FImageSource
+{
+	int PageIndex;
+
+public:
+	F2DAtlasImage(int index)
+	{
+		PageIndex = index;
+		Width = Height = PageSize;
+		SourceLump = -1;
+	}
+
+	TArray<uint8_t> CreatePalettedPixels(int conversion) override;
+	int CopyPixels(FBitmap *bmp, int conversion) override;
+};
+
+TArray<uint8_t> F2DAtlasImage::CreatePalettedPixels(int conversion)
+{
+	TArray<uint8_t> pixels(Width * Height, true);
+	memset(pixels.Data(), 0, pixels.Size());
+
+	for (auto &part : State->Pages[PageIndex].Parts)
+	{
+		auto src = part.Image->GetPalettedPixels(conversion);
+		int w = part.Image->GetWidth();
+		int h = part.Image->GetHeight();
+		if (src.Size() < unsigned(w * h)) continue;
+
+		// Paletted pixels are stored in columns.
+		for (int x = -1; x <= w; x++)
+		{
+			const uint8_t *column = &src[clamp(x, 0, w - 1) * h];
+			uint8_t *dest = &pixels[(part.X + x) * Height + part.Y - 1];
+			dest[0] = column[0];
+			memcpy(dest + 1, column, h);
+			dest[h + 1] = column[h - 1];
+		}
+	}
+	return pixels;
+}
+
+int F2DAtlasImage::CopyPixels(FBitmap *bmp, int conversion)
+{
+	uint8_t *base = bmp->GetPixels();
+	int pitch = bmp->GetPitch();
+
+	for (auto &part : State->Pages[PageIndex].Parts)
+	{
+		FBitmap src = part.Image->GetCachedBitmap(nullptr, conversion);
+		int w = part.Image->GetWidth();
+		int h = part.Image->GetHeight();
+		if (src.GetPixels() == nullptr || src.GetWidth() != w || src.GetHeight() != h) continue;
+
+		for (int y = -1; y <= h; y++)
+		{
+			const uint8_t *row = src.GetPixels() + clamp(y, 0, h - 1) * src.GetPitch();
+			uint8_t *dest = base + (part.Y + y) * pitch + (part.X - 1) * 4;
+			memcpy(dest, row, 4);
+			memcpy(dest + 4, row, w * 4);
+			memcpy(dest + 4 + w * 4, row + (w - 1) * 4, 4);
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+// Shelf packing. Items go on the lowest shelf that is tall enough, unless
+// it is more than twice their height and a new shelf still fits.
+//
+//==========================================================================
+
+static bool Allocate(FAtlasPage &page, int w, int h, int &x, int &y)
+{
+	int best = -1;
+	for (unsigned i = 0; i < page.Shelves.Size(); i++)
+	{
+		auto &shelf = page.Shelves[i];
+		if (shelf.Height >= h && shelf.Used + w <= PageSize && (best < 0 || shelf.Height < page.Shelves[best].Height))
+		{
+			best = i;
+		}
+	}
+	if ((best < 0 || page.Shelves[best].Height > h * 2) && page.Bottom + h <= PageSize)
+	{
+		best = page.Shelves.Push({ page.Bottom, h, 0 });
+		page.Bottom += h;
+	}
+	if (best < 0) return false;
+
+	auto &shelf = page.Shelves[best];
+	x = shelf.Used;
+	y = shelf.Y;
+	shelf.Used += w;
+	return true;
+}
+
+//==========================================================================
+//
+// Only plain textures qualify: anything that needs its own sampler state,
+// additional material layers or a shader of its own is drawn as before.
+//
+//==========================================================================
+
+static bool CanAdd(FGameTexture *img, FImageSource *image)
+{
+	if (img->GetUseType() >= ETextureType::Special || img->isWarped() || img->isHardwareCanvas() || img->isSoftwareCanvas())
+	{
+		return false;
+	}
+	int w = image->GetWidth();
+	int h = image->GetHeight();
+	if (w <= 0 || h <= 0 || w > MaxEntrySize || h > MaxEntrySize)
+	{
+		return false;
+	}
+	return img->isSingleLayer();
+}
+
+static int AddTexture(FGameTexture *img, FImageSource *image, FVector4 &rect)
+{
+	if (!CanAdd(img, image)) return -1;
+
+	auto state = GetState();
+	int w = image->GetWidth();
+	int h = image->GetHeight();
+
+	for (unsigned i = 0; i <= state->Pages.Size(); i++)
+	{
+		if (i == state->Pages.Size())
+		{
+			if (i == MaxPages) return -1;
+
+			FAtlasPage page;
+			page.Image = new F2DAtlasImage(i);
+			page.Texture = MakeGameTexture(CreateImageTexture(page.Image), nullptr, ETextureType::Special);
+			page.Bottom = 0;
+			TexMan.AddGameTexture(page.Texture, false);
+			state->Pages.Push(std::move(page));
+		}
+
+		auto &page = state->Pages[i];
+		int x, y;
+		if (Allocate(page, w + 2, h + 2, x, y))
+		{
+			page.Parts.Push({ image, x + 1, y + 1 });
+			page.Image->bTranslucent = -1;
+			page.Texture->CleanHardwareData();
+			rect = FVector4(float(x + 1) / PageSize, float(y + 1) / PageSize, float(w) / PageSize, float(h) / PageSize);
+			return i;
+		}
+	}
+	return -1;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+FGameTexture *Find(FGameTexture *img, FVector4 &rect)
+{
+	if (!ui_2datlas) return nullptr;
+
+	auto image = img->GetTexture()->GetImage();
+	if (image == nullptr) return nullptr;
+
+	auto state = GetState();
+	auto entry = state->Entries.CheckKey(img);
+	if (entry == nullptr || entry->Image != image)
+	{
+		entry = &state->Entries[img];
+		entry->Image = image;
+		entry->Page = AddTexture(img, image, entry->Rect);
+	}
+	if (entry->Page < 0) return nullptr;
+
+	// Upscaling is done per texture, so this has to be checked on each use.
+	// The renderer does not upscale the pages themselves.
+	if (shouldUpscale(img, img->GetUseType() == ETextureType::FontChar ? UF_Font : UF_Texture)) return nullptr;
+
+	rect = entry->Rect;
+	return state->Pages[entry->Page].Texture;
+}
+
+void Clear()
+{
+	// The page textures themselves are owned by the texture manager.
+	if (State == nullptr) return;
+	State->Pages.Clear();
+	State->Entries.Clear();
+}
+
+}
+
+//==========================================================================
+//
+// STAT 2datlas
+//
+//==========================================================================
+
+ADD_STAT(2datlas)
+{
+	FString out;
+	if (Atlas2D::State == nullptr)
+	{
+		out = "No atlas pages";
+		return out;
+	}
+
+	auto &pages = Atlas2D::State->Pages;
+	unsigned parts = 0;
+	int used = 0;
+	for (auto &page : pages)
+	{
+		parts += page.Parts.Size();
+		for (auto &part : page.Parts)
+		{
+			used += (part.Image->GetWidth() + 2) * (part.Image->GetHeight() + 2);
+		}
+	}
+	out.Format("Pages: %u  Textures: %u  Coverage: %.1f%%", pages.Size(), parts,
+		pages.Size() == 0 ? 0. : used * 100. / (pages.Size() * Atlas2D::PageSize * Atlas2D::PageSize));
+	return out;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "vectors.h"
+
+class FGameTexture;
+
+//==========================================================================
+//
+// 2D texture atlas
+//
+// Small textures that are drawn through F2DDrawer (status bar graphics,
+// font glyphs, menu patches) are copied onto a few shared pages, so that
+// consecutive draws of different graphics use the same texture and the
+// drawer can merge them into one command. Textures are added to a page
+// the first time they are drawn; every addition rebuilds that page's
+// hardware texture, so this settles after the first few frames.
+//
+//==========================================================================
+
+namespace Atlas2D
+{
+	// Returns the page that contains img and writes the position and size
+	// of img on it, in texture coordinates, to rect (x, y, width, height).
+	// Returns nullptr if img has to be drawn on its own.
+	FGameTexture *Find(FGameTexture *img, FVector4 &rect);
+
+	// Forgets all pages. Must be called when the textures get deleted.
+	void Clear();
+}
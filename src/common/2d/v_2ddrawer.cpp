@@ -35,6 +35,7 @@
 #include <stdarg.h>
 #include "templates.h"
 #include "v_2ddrawer.h"
+#include "v_2datlas.h"
 #include "vectors.h"
 #include "vm.h"
 #include "c_cvars.h"
@@ -521,6 +522,26 @@ void F2DDrawer::AddTexture(FGameTexture* img, DrawParms& parms)
 		Set(ptr, x4, y4, 0, u2, v2, vertexcolor); ptr++;
 
 	}
+
+	// Small textures are drawn from a shared atlas page so that consecutive draws of
+	// different graphics can be merged. This only works if the texture coordinates
+	// stay within the image, and not with burn effects that use them for their mask.
+	if (!parms.indexed && !(dg.mFlags & DTF_Burn) && u1 >= 0 && u1 <= 1 && u2 >= 0 && u2 <= 1 && v1 >= 0 && v1 <= 1 && v2 >= 0 && v2 <= 1)
+	{
+		FVector4 rect;
+		auto page = Atlas2D::Find(img, rect);
+		if (page != nullptr)
+		{
+			dg.mTexture = page;
+			TwoDVertex* ptr = &mVertices[dg.mVertIndex];
+			for (int i = 0; i < 4; i++, ptr++)
+			{
+				ptr->u = rect.X + ptr->u * rect.Z;
+				ptr->v = rect.Y + ptr->v * rect.W;
+			}
+		}
+	}
+
 	dg.mIndexIndex = mIndices.Size();
 	dg.mIndexCount += 6;
 	AddIndices(dg.mVertIndex, 6, 0, 1, 2, 1, 3, 2);
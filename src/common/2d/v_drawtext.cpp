@@ -43,6 +43,8 @@
 #include "gstrings.h"
 #include "vm.h"
 #include "printf.h"
+#include "c_cvars.h"
+#include "stats.h"
 
 
 int ListGetInt(VMVa_List &tags);
@@ -246,18 +248,182 @@ DEFINE_ACTION_FUNCTION(_Screen, DrawChar)
 // This is only needed as a dummy. The code using wide strings does not need color control.
 EColorRange V_ParseFontColor(const char32_t *&color_value, int normalcolor, int boldcolor) { return CR_UNTRANSLATED; } 
 
+//==========================================================================
+//
+// Glyph run cache
+//
+// Most text is drawn unchanged for many frames in a row (console, chat,
+// HUD), so the result of decoding a string, parsing its color escapes and
+// looking up its glyphs is kept. Runs store advances in font units; scale,
+// spacing, cell size and position are applied when a run is drawn, so they
+// are not part of the key and resolution changes do not affect the cache.
+// The cache is flushed whenever fonts or their translations are reloaded.
+//
+//==========================================================================
+
+CVAR(Bool, ui_glyphcache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+struct FGlyphRunItem
+{
+	FGameTexture *Pic;		// nullptr if the font has no glyph for the character.
+	int Width;				// -1 for line breaks.
+	int Translation;
+	PalEntry Color;
+};
+
+struct FGlyphRun
+{
+	FFont *Font;
+	int NormalColor;
+	int MaxStrLen;
+	bool PaletteTrans;
+	TArray<uint8_t> Text;
+	TArray<FGlyphRunItem> Items;
+	PalEntry Color;			// font color after the last escape
+	unsigned LastUse;
+};
+
+enum
+{
+	MaxGlyphRuns = 1024
+};
+
+static TMap<uint64_t, FGlyphRun> GlyphRuns;
+static FGlyphRun ScratchRun;
+static unsigned GlyphRunUse, GlyphRunPurge;
+static unsigned GlyphRunHits, GlyphRunMisses;
+
+void V_ClearGlyphRuns()
+{
+	GlyphRuns.Clear();
+}
+
+static inline uint64_t HashGlyphRun(uint64_t hash, uint64_t value)
+{
+	return (hash ^ value) * 1099511628211ull;
+}
+
+// Drops everything that was not used since the last purge. If that does not
+// free anything the whole cache is cleared, so that this does not run on
+// every new string.
+static void PurgeGlyphRuns()
+{
+	TArray<uint64_t> stale;
+	decltype(GlyphRuns)::Iterator it(GlyphRuns);
+	decltype(GlyphRuns)::Pair *pair;
+	while (it.NextPair(pair))
+	{
+		if (pair->Value.LastUse < GlyphRunPurge) stale.Push(pair->Key);
+	}
+	if (stale.Size() == 0) GlyphRuns.Clear();
+	for (auto key : stale) GlyphRuns.Remove(key);
+	GlyphRunPurge = GlyphRunUse;
+}
+
+template<class chartype>
+static void BuildGlyphRun(FGlyphRun &run, FFont *font, int normalcolor, bool palettetrans, const chartype *string, int maxstrlen)
+{
+	int w;
+	const chartype *ch;
+	int c;
+	int trans;
+	FGameTexture *pic;
+
+	int boldcolor = normalcolor ? normalcolor - 1 : NumTextColors - 1;
+
+	PalEntry color = 0xffffffff;
+	trans = palettetrans? -1 : font->GetColorTranslation((EColorRange)normalcolor, &color);
+
+	run.Items.Clear();
+	ch = string;
+
+	auto currentcolor = normalcolor;
+	while (ch - string < maxstrlen)
+	{
+		c = GetCharFromString(ch);
+		if (!c)
+			break;
+
+		if (c == TEXTCOLOR_ESCAPE)
+		{
+			EColorRange newcolor = V_ParseFontColor(ch, normalcolor, boldcolor);
+			if (newcolor != CR_UNDEFINED)
+			{
+				trans = font->GetColorTranslation(newcolor, &color);
+				currentcolor = newcolor;
+			}
+			continue;
+		}
+
+		if (c == '\n')
+		{
+			run.Items.Push({ nullptr, -1, trans, color });
+			continue;
+		}
+
+		pic = font->GetChar(c, currentcolor, &w);
+		run.Items.Push({ pic, w, trans, color });
+	}
+	run.Color = color;
+}
+
+template<class chartype>
+static FGlyphRun *GetGlyphRun(FFont *font, int normalcolor, bool palettetrans, const chartype *string, int maxstrlen)
+{
+	if (!ui_glyphcache)
+	{
+		BuildGlyphRun(ScratchRun, font, normalcolor, palettetrans, string, maxstrlen);
+		return &ScratchRun;
+	}
+
+	const chartype *end = string;
+	uint64_t key = 14695981039346656037ull;
+	for (; *end; end++) key = HashGlyphRun(key, (uint64_t)*end);
+	key = HashGlyphRun(key, (uint64_t)(uintptr_t)font);
+	key = HashGlyphRun(key, (uint64_t)normalcolor);
+	key = HashGlyphRun(key, (uint64_t)maxstrlen);
+	key = HashGlyphRun(key, palettetrans * 2 + sizeof(chartype));
+	size_t length = (end - string) * sizeof(chartype);
+
+	GlyphRunUse++;
+	auto run = GlyphRuns.CheckKey(key);
+	if (run != nullptr && run->Font == font && run->NormalColor == normalcolor && run->MaxStrLen == maxstrlen && run->PaletteTrans == palettetrans &&
+		run->Text.Size() == length && !memcmp(run->Text.Data(), string, length))
+	{
+		GlyphRunHits++;
+		run->LastUse = GlyphRunUse;
+		return run;
+	}
+
+	// A new string or a hash collision, which just replaces the older run.
+	GlyphRunMisses++;
+	if (run == nullptr && GlyphRuns.CountUsed() >= MaxGlyphRuns) PurgeGlyphRuns();
+	run = &GlyphRuns[key];
+	run->Font = font;
+	run->NormalColor = normalcolor;
+	run->MaxStrLen = maxstrlen;
+	run->PaletteTrans = palettetrans;
+	run->Text.Resize((unsigned)length);
+	memcpy(run->Text.Data(), string, length);
+	run->LastUse = GlyphRunUse;
+	BuildGlyphRun(*run, font, normalcolor, palettetrans, string, maxstrlen);
+	return run;
+}
+
+ADD_STAT(glyphruns)
+{
+	FString out;
+	out.Format("Cached runs: %u  Hits: %u  Misses: %u", GlyphRuns.CountUsed(), GlyphRunHits, GlyphRunMisses);
+	return out;
+}
+
 template<class chartype>
 void DrawTextCommon(F2DDrawer *drawer, FFont *font, int normalcolor, double x, double y, const chartype *string, DrawParms &parms)
 {
 	int 		w;
-	const chartype *ch;
-	int 		c;
 	double 		cx;
 	double 		cy;
-	int			boldcolor;
-	int			trans = -1;
 	int			kerning;
-	FGameTexture *pic;
 
 	double scalex = parms.scalex * parms.patchscalex;
 	double scaley = parms.scaley * parms.patchscaley;
@@ -269,16 +435,17 @@ void DrawTextCommon(F2DDrawer *drawer, FFont *font, int normalcolor, double x, d
 
 	if (normalcolor >= NumTextColors)
 		normalcolor = CR_UNTRANSLATED;
-	boldcolor = normalcolor ? normalcolor - 1 : NumTextColors - 1;
+
+	auto run = GetGlyphRun(font, normalcolor, palettetrans, string, parms.maxstrlen);
 
 	PalEntry colorparm = parms.color;
-	PalEntry color = 0xffffffff;
-	trans = palettetrans? -1 : font->GetColorTranslation((EColorRange)normalcolor, &color);
-	parms.color = PalEntry(colorparm.a, (color.r * colorparm.r) / 255, (color.g * colorparm.g) / 255, (color.b * colorparm.b) / 255);
+	auto setcolor = [&](PalEntry color)
+	{
+		parms.color = PalEntry(colorparm.a, (color.r * colorparm.r) / 255, (color.g * colorparm.g) / 255, (color.b * colorparm.b) / 255);
+	};
 
 	kerning = font->GetDefaultKerning();
 
-	ch = string;
 	cx = x;
 	cy = y;
 
@@ -287,38 +454,22 @@ void DrawTextCommon(F2DDrawer *drawer, FFont *font, int normalcolor, double x, d
 	else if (parms.monospace == EMonospacing::CellRight)
 		cx += parms.spacing;
 
-
-	auto currentcolor = normalcolor;
-	while (ch - string < parms.maxstrlen)
+	for (auto &item : run->Items)
 	{
-		c = GetCharFromString(ch);
-		if (!c)
-			break;
-
-		if (c == TEXTCOLOR_ESCAPE)
-		{
-			EColorRange newcolor = V_ParseFontColor(ch, normalcolor, boldcolor);
-			if (newcolor != CR_UNDEFINED)
-			{
-				trans = font->GetColorTranslation(newcolor, &color);
-				parms.color = PalEntry(colorparm.a, (color.r * colorparm.r) / 255, (color.g * colorparm.g) / 255, (color.b * colorparm.b) / 255);
-				currentcolor = newcolor;
-			}
-			continue;
-		}
-
-		if (c == '\n')
+		if (item.Width < 0)
 		{
 			cx = x;
 			cy += parms.celly;
 			continue;
 		}
 
-		if (NULL != (pic = font->GetChar(c, currentcolor, &w)))
+		w = item.Width;
+		if (item.Pic != nullptr)
 		{
+			setcolor(item.Color);
 			// if palette translation is used, font colors will be ignored.
-			if (!palettetrans) parms.TranslationId = trans;
-			SetTextureParms(drawer, &parms, pic, cx, cy);
+			if (!palettetrans) parms.TranslationId = item.Translation;
+			SetTextureParms(drawer, &parms, item.Pic, cx, cy);
 			if (parms.cellx)
 			{
 				w = parms.cellx;
@@ -332,7 +483,7 @@ void DrawTextCommon(F2DDrawer *drawer, FFont *font, int normalcolor, double x, d
 			else if (parms.monospace == EMonospacing::CellRight)
 				parms.left = w;
 
-			drawer->AddTexture(pic, parms);
+			drawer->AddTexture(item.Pic, parms);
 		}
 		if (parms.monospace == EMonospacing::Off)
 		{
@@ -344,6 +495,7 @@ void DrawTextCommon(F2DDrawer *drawer, FFont *font, int normalcolor, double x, d
 		}
 
 	}
+	setcolor(run->Color);
 }
 
 
@@ -36,6 +36,7 @@
 #include <stdlib.h>
 
 #include "oalsound.h"
+#include "softsound.h"
 
 #include "i_module.h"
 #include "cmdlib.h"
@@ -157,6 +158,10 @@ public:
 	{
 		return 0;
 	}
+	unsigned int GetDataSize(SoundHandle sfx)
+	{
+		return 0;
+	}
 	float GetOutputRate()
 	{
 		return 11025;	// Lies!
@@ -263,8 +268,13 @@ void I_InitSound ()
 		return;
 	}
 
-	// Keep it simple: let everything except "null" init the sound.
-	if (stricmp(snd_backend, "null") == 0)
+	// "software" and -softsound select the device-less mixer, "null" disables
+	// the sound, and everything else tries OpenAL.
+	if (Args->CheckParm("-softsound") || stricmp(snd_backend, "software") == 0)
+	{
+		GSnd = new SoftSoundRenderer;
+	}
+	else if (stricmp(snd_backend, "null") == 0)
 	{
 		GSnd = new NullSoundRenderer;
 	}
@@ -494,3 +504,66 @@ SoundHandle SoundRenderer::LoadSoundVoc(uint8_t *sfxdata, int length)
 	return retval;
 }
 
+//==========================================================================
+//
+// S_DecodeSound
+//
+// Decodes a compressed sound the same way OpenALSoundRenderer::LoadSound
+// does, but only to memory. This does not print anything because it is
+// used by the sound cache's worker threads.
+//
+//==========================================================================
+
+bool S_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out)
+{
+	uint32_t loop_start = 0, loop_end = ~0u;
+	zmusic_bool startass = false, endass = false;
+	ChannelConfig chans;
+	SampleType type;
+	int srate;
+
+	FindLoopTags(sfxdata, length, &loop_start, &startass, &loop_end, &endass);
+	auto decoder = CreateDecoder(sfxdata, length, true);
+	if (!decoder)
+		return false;
+
+	SoundDecoder_GetInfo(decoder, &srate, &chans, &type);
+	if ((chans != ChannelConfig_Mono && chans != ChannelConfig_Stereo) ||
+		(type != SampleType_UInt8 && type != SampleType_Int16) || srate <= 0)
+	{
+		SoundDecoder_Close(decoder);
+		return false;
+	}
+	out.Frequency = srate;
+	out.Channels = chans == ChannelConfig_Stereo ? 2 : 1;
+	out.Bits = type == SampleType_Int16 ? 16 : 8;
+
+	unsigned total = 0;
+	unsigned got;
+
+	out.Data.Resize(32768);
+	while ((got = (unsigned)SoundDecoder_Read(decoder, (char*)&out.Data[total], out.Data.Size() - total)) > 0)
+	{
+		total += got;
+		out.Data.Resize(total * 2);
+	}
+	SoundDecoder_Close(decoder);
+	out.Data.Resize(total);
+	out.Data.ShrinkToFit();
+	if (total == 0)
+		return false;
+
+	if (!startass) loop_start = uint32_t((uint64_t)loop_start * srate / 1000);
+	if (!endass && loop_end != ~0u) loop_end = uint32_t((uint64_t)loop_end * srate / 1000);
+	const uint32_t samples = total / (out.Channels * out.Bits / 8);
+	if (loop_start > samples) loop_start = 0;
+	if (loop_end > samples) loop_end = samples;
+
+	if ((loop_start > 0 || loop_end > 0) && loop_end > loop_start)
+	{
+		out.LoopStart = loop_start;
+		out.LoopEnd = loop_end;
+	}
+	return true;
+}
+
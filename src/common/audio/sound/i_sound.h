@@ -38,6 +38,7 @@
 #include <vector>
 #include "i_soundinternal.h"
 #include "zstring.h"
+#include "tarray.h"
 #include <zmusic.h>
 
 class FileReader;
@@ -103,6 +104,7 @@ public:
 	virtual void UnloadSound (SoundHandle sfx) = 0;	// unloads a sound from memory
 	virtual unsigned int GetMSLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
 	virtual unsigned int GetSampleLength(SoundHandle sfx) = 0;	// Gets the length of a sound at its default frequency
+	virtual unsigned int GetDataSize(SoundHandle sfx) = 0;	// Gets the number of bytes the sample data occupies
 	virtual float GetOutputRate() = 0;
 
 	// Streaming sounds.
@@ -171,4 +173,19 @@ extern ReverbContainer *DefaultEnvironments[26];
 bool IsOpenALPresent();
 void S_SoundReset();
 
+// A compressed sound decoded to PCM, ready for LoadSoundRaw.
+// Loop points are in sample frames.
+struct FDecodedSound
+{
+	TArray<uint8_t> Data;
+	int Frequency = 0;
+	int Channels = 0;
+	int Bits = 0;
+	int LoopStart = 0;
+	int LoopEnd = -1;
+};
+
+// Does not touch the sound renderer, so it may be called from any thread.
+bool S_DecodeSound(const uint8_t *sfxdata, int length, FDecodedSound &out);
+
 #endif
@@ -974,6 +974,19 @@ unsigned int OpenALSoundRenderer::GetSampleLength(SoundHandle sfx)
 	return 0;
 }
 
+unsigned int OpenALSoundRenderer::GetDataSize(SoundHandle sfx)
+{
+	if(sfx.data)
+	{
+		ALuint buffer = GET_PTRID(sfx.data);
+		ALint size;
+		alGetBufferi(buffer, AL_SIZE, &size);
+		if(getALError() == AL_NO_ERROR)
+			return (unsigned int)size;
+	}
+	return 0;
+}
+
 float OpenALSoundRenderer::GetOutputRate()
 {
 	ALCint rate = 44100; // Default, just in case
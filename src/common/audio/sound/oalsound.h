@@ -132,6 +132,7 @@ public:
 	virtual void UnloadSound(SoundHandle sfx);
 	virtual unsigned int GetMSLength(SoundHandle sfx);
 	virtual unsigned int GetSampleLength(SoundHandle sfx);
+	virtual unsigned int GetDataSize(SoundHandle sfx);
 	virtual float GetOutputRate();
 
 	// Streaming sounds.
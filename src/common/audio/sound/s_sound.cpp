@@ -35,6 +35,10 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 #include "templates.h"
 #include "s_soundinternal.h"
@@ -43,6 +47,9 @@
 #include "s_music.h"
 #include "m_random.h"
 #include "printf.h"
+#include "stats.h"
+#include "c_cvars.h"
+#include "threadpool.h"
 
 
 enum
@@ -52,6 +59,58 @@ enum
 static FRandom pr_soundpitch ("SoundPitch");
 SoundEngine* soundEngine;
 
+CVAR(Bool, snd_asyncdecode, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, snd_cachesize, 256, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// in MB, 0 means no limit
+{
+	if (self < 0) self = 0;
+}
+
+//==========================================================================
+//
+// A precached sound waiting for a worker thread to decode it. Whoever
+// moves it from Queued to Running does the decoding, so if the sound is
+// needed before a worker got to it, the game thread simply takes it over.
+// The task holds its own reference, so the engine may drop a job anytime.
+//
+//==========================================================================
+
+struct FSoundDecodeJob
+{
+	enum { Queued, Running, Done };
+
+	std::atomic<int> State { Queued };
+	std::mutex DoneLock;
+	std::condition_variable DoneCond;
+	TArray<uint8_t> Source;
+	FDecodedSound Result;
+	bool Success = false;
+
+	bool Claim()
+	{
+		int expected = Queued;
+		return State.compare_exchange_strong(expected, Running);
+	}
+
+	void Decode()
+	{
+		Success = S_DecodeSound(Source.Data(), Source.Size(), Result);
+		Source.Reset();
+		{
+			std::lock_guard<std::mutex> lock(DoneLock);
+			State = Done;
+		}
+		DoneCond.notify_all();
+	}
+
+	void WaitDone()
+	{
+		std::unique_lock<std::mutex> lock(DoneLock);
+		DoneCond.wait(lock, [this]() { return State == Done; });
+	}
+};
+
+static FTaskGroup *DecodeTasks;	// never deleted, the pool may be gone before static destruction.
+
 //==========================================================================
 //
 // S_Init
@@ -131,6 +190,9 @@ void SoundEngine::CacheMarkedSounds()
 		MarkUsed(chan->SoundID);
 	}
 
+	// Compressed sounds get queued for the worker threads here and are
+	// uploaded by UpdateSounds once they are done.
+	PrecachingSounds = true;
 	for (unsigned i = 1; i < S_sfx.Size(); ++i)
 	{
 		if (S_sfx[i].bUsed)
@@ -138,6 +200,7 @@ void SoundEngine::CacheMarkedSounds()
 			CacheSound(&S_sfx[i]);
 		}
 	}
+	PrecachingSounds = false;
 	for (unsigned i = 1; i < S_sfx.Size(); ++i)
 	{
 		if (!S_sfx[i].bUsed && S_sfx[i].link == sfxinfo_t::NO_LINK)
@@ -182,12 +245,174 @@ void SoundEngine::CacheSound (sfxinfo_t *sfx)
 
 void SoundEngine::UnloadSound (sfxinfo_t *sfx)
 {
+	CancelDecode(sfx);
 	if (sfx->data.isValid())
 	{
 		GSnd->UnloadSound(sfx->data);
+		LoadedBytes -= sfx->DataSize;
 		DPrintf(DMSG_NOTIFY, "Unloaded sound \"%s\" (%td)\n", sfx->name.GetChars(), sfx - &S_sfx[0]);
 	}
 	sfx->data.Clear();
+	sfx->DataSize = 0;
+}
+
+//==========================================================================
+//
+// Sound cache
+//
+// QueueDecode hands a compressed sound to the worker threads. The lump is
+// read here, because the file system may only be used by the game thread,
+// and the upload to the sound renderer happens in FinishDecode, for the
+// same reason.
+//
+//==========================================================================
+
+bool SoundEngine::QueueDecode(sfxinfo_t *sfx, TArray<uint8_t> &sfxdata)
+{
+	if (ThreadPool::NumWorkers() == 0)
+	{
+		return false;
+	}
+
+	auto job = std::make_shared<FSoundDecodeJob>();
+	job->Source = std::move(sfxdata);
+	sfx->DecodeJob = job;
+	PendingDecodes.Push(unsigned(sfx - &S_sfx[0]));
+
+	if (DecodeTasks == nullptr) DecodeTasks = new FTaskGroup;
+	DecodeTasks->Run([job]()
+	{
+		if (job->Claim()) job->Decode();
+	});
+	return true;
+}
+
+//==========================================================================
+//
+// Uploads a decoded sound. Without wait this only does something if
+// the worker is done; with it, the sound gets decoded here if no worker
+// has started on it yet.
+//
+//==========================================================================
+
+bool SoundEngine::FinishDecode(sfxinfo_t *sfx, bool wait)
+{
+	auto job = sfx->DecodeJob;
+	if (job->State != FSoundDecodeJob::Done)
+	{
+		if (!wait)
+		{
+			return false;
+		}
+		if (job->Claim())
+		{
+			job->Decode();
+			DecodedOnDemand++;
+		}
+		else
+		{
+			job->WaitDone();
+			DecodedAsync++;
+		}
+	}
+	else
+	{
+		DecodedAsync++;
+	}
+
+	sfx->DecodeJob.reset();
+	PendingDecodes.Delete(PendingDecodes.Find(unsigned(sfx - &S_sfx[0])));
+
+	if (job->Success)
+	{
+		auto &res = job->Result;
+		sfx->data = GSnd->LoadSoundRaw(res.Data.Data(), res.Data.Size(), res.Frequency, res.Channels, res.Bits, res.LoopStart, res.LoopEnd);
+	}
+	if (sfx->data.isValid())
+	{
+		SoundLoaded(sfx);
+	}
+	else
+	{
+		sfx->lumpnum = sfx_empty;
+	}
+	return true;
+}
+
+void SoundEngine::FinishDecodes()
+{
+	for (unsigned i = PendingDecodes.Size(); i-- > 0; )
+	{
+		if (i < PendingDecodes.Size())
+		{
+			FinishDecode(&S_sfx[PendingDecodes[i]], false);
+		}
+	}
+}
+
+void SoundEngine::CancelDecode(sfxinfo_t *sfx)
+{
+	if (sfx->DecodeJob == nullptr)
+	{
+		return;
+	}
+	// If no worker has started on it yet, this makes it skip the job.
+	sfx->DecodeJob->Claim();
+	sfx->DecodeJob.reset();
+	PendingDecodes.Delete(PendingDecodes.Find(unsigned(sfx - &S_sfx[0])));
+}
+
+//==========================================================================
+//
+// Accounts for a newly loaded sound and, if the cache is over budget,
+// unloads the sounds that have not been used for the longest time.
+// Sounds that are playing stay, and so does the one that was just loaded.
+//
+//==========================================================================
+
+void SoundEngine::SoundLoaded(sfxinfo_t *sfx)
+{
+	sfx->DataSize = GSnd->GetDataSize(sfx->data);
+	LoadedBytes += sfx->DataSize;
+	TrimSoundCache(sfx);
+}
+
+void SoundEngine::TrimSoundCache(sfxinfo_t *keep)
+{
+	if (snd_cachesize <= 0) return;
+	size_t limit = size_t(*snd_cachesize) << 20;
+	if (LoadedBytes <= limit) return;
+
+	TArray<bool> playing(S_sfx.Size(), true);
+	memset(playing.Data(), 0, playing.Size());
+	for (FSoundChan* chan = Channels; chan != nullptr; chan = chan->NextChan)
+	{
+		// The channel plays the sound its sound is linked to.
+		for (unsigned id = chan->SoundID; id < S_sfx.Size() && !playing[id]; id = S_sfx[id].link)
+		{
+			playing[id] = true;
+			if (S_sfx[id].bRandomHeader) break;
+		}
+	}
+
+	TArray<unsigned> candidates;
+	for (unsigned i = 1; i < S_sfx.Size(); i++)
+	{
+		if (S_sfx[i].data.isValid() && !playing[i] && &S_sfx[i] != keep)
+		{
+			candidates.Push(i);
+		}
+	}
+	std::sort(candidates.begin(), candidates.end(), [this](unsigned a, unsigned b) { return S_sfx[a].LastUsed < S_sfx[b].LastUsed; });
+
+	// Go a bit below the limit so that this does not run again for the next sound.
+	size_t target = limit - limit / 8;
+	for (auto i : candidates)
+	{
+		if (LoadedBytes <= target) break;
+		UnloadSound(&S_sfx[i]);
+		EvictedSounds++;
+	}
 }
 
 //==========================================================================
@@ -227,6 +452,7 @@ FSoundChan *SoundEngine::GetChannel(void *syschan)
 
 void SoundEngine::ReturnChannel(FSoundChan *chan)
 {
+	UnindexChannel(chan);
 	UnlinkChannel(chan);
 	memset(chan, 0, sizeof(*chan));
 	LinkChannel(chan, &FreeChannels);
@@ -264,6 +490,53 @@ void SoundEngine::LinkChannel(FSoundChan *chan, FSoundChan **head)
 	chan->PrevChan = head;
 }
 
+//==========================================================================
+//
+// SoundEngine :: IndexChannel
+//
+// Links a channel into the hash chains for its current sound and source.
+// Channels that are not attached to anything are only indexed by sound.
+//
+//==========================================================================
+
+void SoundEngine::IndexChannel(FSoundChan *chan)
+{
+	UnindexChannel(chan);
+
+	FSoundChan **head = &SoundIndex[chan->SoundID & (CHANINDEX_SIZE - 1)];
+	chan->NextBySound = *head;
+	if (*head != nullptr) (*head)->PrevBySound = &chan->NextBySound;
+	*head = chan;
+	chan->PrevBySound = head;
+
+	if (chan->Source != nullptr)
+	{
+		head = &SourceIndex[SourceHash(chan->SourceType, chan->Source)];
+		chan->NextBySource = *head;
+		if (*head != nullptr) (*head)->PrevBySource = &chan->NextBySource;
+		*head = chan;
+		chan->PrevBySource = head;
+	}
+}
+
+void SoundEngine::UnindexChannel(FSoundChan *chan)
+{
+	if (chan->PrevBySound != nullptr)
+	{
+		*chan->PrevBySound = chan->NextBySound;
+		if (chan->NextBySound != nullptr) chan->NextBySound->PrevBySound = chan->PrevBySound;
+		chan->NextBySound = nullptr;
+		chan->PrevBySound = nullptr;
+	}
+	if (chan->PrevBySource != nullptr)
+	{
+		*chan->PrevBySource = chan->NextBySource;
+		if (chan->NextBySource != nullptr) chan->NextBySource->PrevBySource = chan->PrevBySource;
+		chan->NextBySource = nullptr;
+		chan->PrevBySource = nullptr;
+	}
+}
+
 //==========================================================================
 //
 //
@@ -385,6 +658,14 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	if (sound_id <= 0 || volume <= 0 || nosfx || nosound || blockNewSounds)
 		return NULL;
 
+	StartSoundCalls++;
+	struct FTimer
+	{
+		cycle_t &Cycles;
+		FTimer(cycle_t &c) : Cycles(c) { Cycles.Clock(); }
+		~FTimer() { Cycles.Unclock(); }
+	} timer(StartSoundCycles);
+
 	// prevent crashes.
 	if (type == SOURCE_Unattached && pt == nullptr) type = SOURCE_None;
 
@@ -510,20 +791,35 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 	// If this actor is already playing something on the selected channel, stop it.
 	if (!(chanflags & CHANF_OVERLAP) && type != SOURCE_None && ((source == NULL && channel != CHAN_AUTO) || (source != NULL && IsChannelUsed(type, source, channel, &seen))))
 	{
-		for (chan = Channels; chan != NULL; chan = chan->NextChan)
+		if (source != NULL)
 		{
-			if (chan->SourceType == type && chan->EntChannel == channel)
+			FSoundChan *next;
+			for (chan = SourceIndex[SourceHash(type, source)]; chan != NULL; chan = next)
 			{
-				const bool foundit = (type == SOURCE_Unattached)
-					? (chan->Point[0] == pt->X && chan->Point[2] == pt->Z && chan->Point[1] == pt->Y)
-					: (chan->Source == source);
-
-				if (foundit)
+				next = chan->NextBySource;
+				if (chan->SourceType == type && chan->EntChannel == channel && chan->Source == source)
 				{
 					StopChannel(chan);
 				}
 			}
 		}
+		else
+		{
+			for (chan = Channels; chan != NULL; chan = chan->NextChan)
+			{
+				if (chan->SourceType == type && chan->EntChannel == channel)
+				{
+					const bool foundit = (type == SOURCE_Unattached)
+						? (chan->Point[0] == pt->X && chan->Point[2] == pt->Z && chan->Point[1] == pt->Y)
+						: (chan->Source == source);
+
+					if (foundit)
+					{
+						StopChannel(chan);
+					}
+				}
+			}
+		}
 	}
 
 	// sound is paused and a non-looped sound is being started.
@@ -605,6 +901,7 @@ FSoundChan *SoundEngine::StartSound(int type, const void *source,
 		{
 			chan->Source = source;
 		}
+		IndexChannel(chan);
 		
 		if (spitch > 0.0)				// A_StartSound has top priority over all others.
 			SetPitch(chan, spitch);
@@ -712,6 +1009,7 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 {
 	if (GSnd->IsNull()) return sfx;
 
+	sfx->LastUsed = ++UseCounter;
 	while (!sfx->data.isValid())
 	{
 		unsigned int i;
@@ -720,12 +1018,20 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 		{
 			return sfx;
 		}
+
+		if (sfx->DecodeJob != nullptr)
+		{
+			// While precaching, leave it to the worker. Otherwise it is needed now.
+			if (PrecachingSounds) return sfx;
+			FinishDecode(sfx, true);
+			continue;
+		}
 		
 		// See if there is another sound already initialized with this lump. If so,
 		// then set this one up as a link, and don't load the sound again.
 		for (i = 0; i < S_sfx.Size(); i++)
 		{
-			if (S_sfx[i].data.isValid() && S_sfx[i].link == sfxinfo_t::NO_LINK && S_sfx[i].lumpnum == sfx->lumpnum &&
+			if ((S_sfx[i].data.isValid() || S_sfx[i].DecodeJob != nullptr) && S_sfx[i].link == sfxinfo_t::NO_LINK && S_sfx[i].lumpnum == sfx->lumpnum &&
 				(!sfx->bLoadRAW || (sfx->RawRate == S_sfx[i].RawRate)))	// Raw sounds with different sample rates may not share buffers, even if they use the same source data.
 			{
 				DPrintf (DMSG_NOTIFY, "Linked %s to %s (%d)\n", sfx->name.GetChars(), S_sfx[i].name.GetChars(), i);
@@ -733,7 +1039,7 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 				// This is necessary to avoid using the rolloff settings of the linked sound if its
 				// settings are different.
 				if (sfx->Rolloff.MinDistance == 0) sfx->Rolloff = S_Rolloff;
-				return &S_sfx[i];
+				return LoadSound(&S_sfx[i]);
 			}
 		}
 
@@ -765,6 +1071,10 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 			// If that fails, let the sound system try and figure it out.
 			else
 			{
+				if (PrecachingSounds && snd_asyncdecode && QueueDecode(sfx, sfxdata))
+				{
+					return sfx;
+				}
 				sfx->data = GSnd->LoadSound(sfxdata.Data(), size);
 			}
 		}
@@ -777,6 +1087,7 @@ sfxinfo_t *SoundEngine::LoadSound(sfxinfo_t *sfx)
 				continue;
 			}
 		}
+		SoundLoaded(sfx);
 		break;
 	}
 	return sfx;
@@ -824,11 +1135,12 @@ bool SoundEngine::CheckSoundLimit(sfxinfo_t *sfx, const FVector3 &pos, int near_
 {
 	FSoundChan *chan;
 	int count;
+	int sfxid = int(sfx - S_sfx.Data());
 	
-	for (chan = Channels, count = 0; chan != NULL && count < near_limit; chan = chan->NextChan)
+	for (chan = SoundIndex[sfxid & (CHANINDEX_SIZE - 1)], count = 0; chan != NULL && count < near_limit; chan = chan->NextBySound)
 	{
 		if (chan->ChanFlags & CHANF_FORGETTABLE) continue;
-		if (!(chan->ChanFlags & CHANF_EVICTED) && &S_sfx[chan->SoundID] == sfx)
+		if (!(chan->ChanFlags & CHANF_EVICTED) && chan->SoundID == sfxid)
 		{
 			FVector3 chanorigin;
 
@@ -904,10 +1216,28 @@ void SoundEngine::StopSound (int channel, int sound_id)
 
 void SoundEngine::StopSound(int sourcetype, const void* actor, int channel, int sound_id)
 {
-	FSoundChan* chan = Channels;
+	if (actor == nullptr)
+	{
+		// Channels without a source are not in the source index.
+		FSoundChan* chan = Channels;
+		while (chan != NULL)
+		{
+			FSoundChan* next = chan->NextChan;
+			if (chan->SourceType == sourcetype &&
+				chan->Source == actor &&
+				(sound_id == -1 ? (chan->EntChannel == channel || channel < 0) : (chan->OrgID == sound_id)))
+			{
+				StopChannel(chan);
+			}
+			chan = next;
+		}
+		return;
+	}
+
+	FSoundChan* chan = SourceIndex[SourceHash(sourcetype, actor)];
 	while (chan != NULL)
 	{
-		FSoundChan* next = chan->NextChan;
+		FSoundChan* next = chan->NextBySource;
 		if (chan->SourceType == sourcetype &&
 			chan->Source == actor &&
 			(sound_id == -1? (chan->EntChannel == channel || channel < 0) : (chan->OrgID == sound_id)))
@@ -931,10 +1261,10 @@ void SoundEngine::StopActorSounds(int sourcetype, const void* actor, int chanmin
 	const bool all = (chanmin == 0 && chanmax == 0);
 	if (chanmax < chanmin) std::swap(chanmin, chanmax);
 
-	FSoundChan* chan = Channels;
+	FSoundChan* chan = actor != nullptr ? SourceIndex[SourceHash(sourcetype, actor)] : Channels;
 	while (chan != nullptr)
 	{
-		FSoundChan* next = chan->NextChan;
+		FSoundChan* next = actor != nullptr ? chan->NextBySource : chan->NextChan;
 		if (chan->SourceType == sourcetype &&
 			chan->Source == actor &&
 			(all || (chan->EntChannel >= chanmin && chan->EntChannel <= chanmax)))
@@ -978,15 +1308,16 @@ void SoundEngine::RelinkSound (int sourcetype, const void *from, const void *to,
 	if (from == NULL)
 		return;
 
-	FSoundChan *chan = Channels;
+	FSoundChan *chan = SourceIndex[SourceHash(sourcetype, from)];
 	while (chan != NULL)
 	{
-		FSoundChan *next = chan->NextChan;
+		FSoundChan *next = chan->NextBySource;
 		if (chan->SourceType == sourcetype && chan->Source == from)
 		{
 			if (to != NULL)
 			{
 				chan->Source = to;
+				IndexChannel(chan);
 			}
 			else if (!(chan->ChanFlags & CHANF_LOOP) && optpos)
 			{
@@ -995,6 +1326,7 @@ void SoundEngine::RelinkSound (int sourcetype, const void *from, const void *to,
 				chan->Point[0] = optpos->X;
 				chan->Point[1] = optpos->Y;
 				chan->Point[2] = optpos->Z;
+				IndexChannel(chan);
 			}
 			else
 			{
@@ -1081,7 +1413,17 @@ void SoundEngine::SetPitch(FSoundChan *chan, float pitch)
 int SoundEngine::GetSoundPlayingInfo (int sourcetype, const void *source, int sound_id)
 {
 	int count = 0;
-	if (sound_id > 0)
+	if (sourcetype != SOURCE_Any && source != nullptr)
+	{
+		for (FSoundChan *chan = SourceIndex[SourceHash(sourcetype, source)]; chan != NULL; chan = chan->NextBySource)
+		{
+			if (chan->SourceType == sourcetype && chan->Source == source && (sound_id <= 0 || chan->OrgID == sound_id))
+			{
+				count++;
+			}
+		}
+	}
+	else if (sound_id > 0)
 	{
 		for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
 		{
@@ -1122,7 +1464,7 @@ bool SoundEngine::IsChannelUsed(int sourcetype, const void *actor, int channel,
 	{
 		return true;
 	}
-	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
+	for (FSoundChan *chan = SourceIndex[SourceHash(sourcetype, actor)]; chan != NULL; chan = chan->NextBySource)
 	{
 		if (chan->SourceType == sourcetype && chan->Source == actor)
 		{
@@ -1144,6 +1486,18 @@ bool SoundEngine::IsChannelUsed(int sourcetype, const void *actor, int channel,
 
 bool SoundEngine::IsSourcePlayingSomething (int sourcetype, const void *actor, int channel, int sound_id)
 {
+	if (sourcetype != SOURCE_None && sourcetype != SOURCE_Unattached && actor != nullptr)
+	{
+		for (FSoundChan *chan = SourceIndex[SourceHash(sourcetype, actor)]; chan != NULL; chan = chan->NextBySource)
+		{
+			if (chan->SourceType == sourcetype && chan->Source == actor &&
+				(channel == 0 || chan->EntChannel == channel) && (sound_id <= 0 || chan->OrgID == sound_id))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
 	for (FSoundChan *chan = Channels; chan != NULL; chan = chan->NextChan)
 	{
 		if (chan->SourceType == sourcetype && (sourcetype == SOURCE_None || sourcetype == SOURCE_Unattached || chan->Source == actor))
@@ -1253,6 +1607,11 @@ void SoundEngine::UpdateSounds(int time)
 {
 	FVector3 pos, vel;
 
+	if (PendingDecodes.Size() > 0)
+	{
+		FinishDecodes();
+	}
+
 	for (FSoundChan* chan = Channels; chan != NULL; chan = chan->NextChan)
 	{
 		if ((chan->ChanFlags & (CHANF_EVICTED | CHANF_IS3D)) == CHANF_IS3D)
@@ -1702,3 +2061,72 @@ void S_SoundReset()
 	S_RestartMusic();
 }
 
+//==========================================================================
+//
+// SoundEngine :: GatherChannelStats
+//
+// StartSound's numbers cover the time since the stat was last drawn.
+//
+//==========================================================================
+
+FString SoundEngine::GatherChannelStats()
+{
+	int active = 0, evicted = 0;
+	for (FSoundChan* chan = Channels; chan != nullptr; chan = chan->NextChan)
+	{
+		active++;
+		if (chan->ChanFlags & CHANF_EVICTED) evicted++;
+	}
+
+	int longestsound = 0, longestsource = 0;
+	for (int i = 0; i < CHANINDEX_SIZE; i++)
+	{
+		int len = 0;
+		for (FSoundChan* chan = SoundIndex[i]; chan != nullptr; chan = chan->NextBySound) len++;
+		longestsound = std::max(longestsound, len);
+		len = 0;
+		for (FSoundChan* chan = SourceIndex[i]; chan != nullptr; chan = chan->NextBySource) len++;
+		longestsource = std::max(longestsource, len);
+	}
+
+	FString out;
+	out.Format("Channels: %d (%d evicted)  StartSound: %d calls, %2.3f ms  Longest chain: %d by sound, %d by source",
+		active, evicted, StartSoundCalls, StartSoundCycles.TimeMS(), longestsound, longestsource);
+	StartSoundCalls = 0;
+	StartSoundCycles.Reset();
+	return out;
+}
+
+ADD_STAT(soundchannels)
+{
+	if (soundEngine == nullptr) return "No sound engine";
+	return soundEngine->GatherChannelStats();
+}
+
+//==========================================================================
+//
+// soundcache stat
+//
+//==========================================================================
+
+FString SoundEngine::GatherCacheStats()
+{
+	int loaded = 0;
+	for (auto &sfx : S_sfx)
+	{
+		if (sfx.data.isValid()) loaded++;
+	}
+
+	FString out;
+	out.Format("Sounds: %d loaded, %.2f MB", loaded, LoadedBytes / 1048576.);
+	if (snd_cachesize > 0) out.AppendFormat(" of %d MB", *snd_cachesize);
+	out.AppendFormat("  Pending decodes: %u  Decoded: %d by workers, %d on demand  Evicted: %d",
+		PendingDecodes.Size(), DecodedAsync, DecodedOnDemand, EvictedSounds);
+	return out;
+}
+
+ADD_STAT(soundcache)
+{
+	if (soundEngine == nullptr) return "No sound engine";
+	return soundEngine->GatherCacheStats();
+}
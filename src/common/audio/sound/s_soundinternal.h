@@ -1,6 +1,10 @@
 #pragma once
 
+#include <memory>
 #include "i_sound.h"
+#include "stats.h"
+
+struct FSoundDecodeJob;
 
 struct FRandomSoundList
 {
@@ -54,6 +58,10 @@ struct sfxinfo_t
 
 	FRolloffInfo	Rolloff{};
 	float		Attenuation = 1.f;			// Multiplies the attenuation passed to S_Sound.
+
+	std::shared_ptr<FSoundDecodeJob> DecodeJob;	// Set while a worker thread decodes this sound.
+	unsigned	DataSize = 0;				// Size of the loaded sample data, for the sound cache budget.
+	unsigned	LastUsed = 0;				// When this sound was last requested, for evicting the least recently used ones.
 };
 
 // Rolloff types
@@ -134,6 +142,8 @@ struct FSoundChan : public FISoundChannel
 {
 	FSoundChan	*NextChan;	// Next channel in this list.
 	FSoundChan **PrevChan;	// Previous channel in this list.
+	FSoundChan	*NextBySound, **PrevBySound;	// Channel index by sound ID, see SoundEngine::IndexChannel.
+	FSoundChan	*NextBySource, **PrevBySource;	// Channel index by source.
 	FSoundID	SoundID;	// Sound ID of playing sound.
 	FSoundID	OrgID;		// Sound ID of sound used to start this channel.
 	float		Volume;
@@ -207,6 +217,24 @@ protected:
 	FSoundChan* Channels = nullptr;
 	FSoundChan* FreeChannels = nullptr;
 
+	// Hash chains of the active channels by sound and by source, so that
+	// limit checks only need to look at the channels that can match.
+	enum { CHANINDEX_SIZE = 256 };
+	FSoundChan* SoundIndex[CHANINDEX_SIZE] = {};
+	FSoundChan* SourceIndex[CHANINDEX_SIZE] = {};
+
+	// For the soundchannels stat.
+	int StartSoundCalls = 0;
+	cycle_t StartSoundCycles;
+
+	// Sound cache. Compressed sounds that get precached are decoded on
+	// worker threads and uploaded to the sound renderer when done.
+	TArray<unsigned> PendingDecodes;
+	bool PrecachingSounds = false;
+	size_t LoadedBytes = 0;
+	unsigned UseCounter = 0;
+	int DecodedAsync = 0, DecodedOnDemand = 0, EvictedSounds = 0;
+
 	// the complete set of sound effects
 	TArray<sfxinfo_t> S_sfx;
 	FRolloffInfo S_Rolloff{};
@@ -222,6 +250,19 @@ private:
 	void RestartChannel(FSoundChan* chan);
 	void RestoreEvictedChannel(FSoundChan* chan);
 
+	void UnindexChannel(FSoundChan* chan);
+	bool QueueDecode(sfxinfo_t* sfx, TArray<uint8_t>& sfxdata);
+	bool FinishDecode(sfxinfo_t* sfx, bool wait);
+	void FinishDecodes();
+	void CancelDecode(sfxinfo_t* sfx);
+	void SoundLoaded(sfxinfo_t* sfx);
+	void TrimSoundCache(sfxinfo_t* keep);
+	static unsigned SourceHash(int sourcetype, const void* source)
+	{
+		uintptr_t p = (uintptr_t)source;
+		return unsigned((p >> 4) ^ (p >> 12) ^ sourcetype) & (CHANINDEX_SIZE - 1);
+	}
+
 	bool IsChannelUsed(int sourcetype, const void* actor, int channel, int* seen);
 	// This is the actual sound positioning logic which needs to be provided by the client.
 	virtual void CalcPosVel(int type, const void* source, const float pt[3], int channel, int chanflags, FSoundID chanSound, FVector3* pos, FVector3* vel, FSoundChan *chan) = 0;
@@ -253,6 +294,10 @@ public:
 	virtual void SetSource(FSoundChan* chan, int index) {}
 
 	virtual void StopChannel(FSoundChan* chan);
+	// Must be called after changing a channel's sound or source.
+	void IndexChannel(FSoundChan* chan);
+	FString GatherChannelStats();
+	FString GatherCacheStats();
 	sfxinfo_t* LoadSound(sfxinfo_t* sfx);
 	const sfxinfo_t* GetSfx(unsigned snd)
 	{
@@ -0,0 +1,846 @@
+/*
+** softsound.cpp
+** Software mixing sound renderer that does not need an audio device
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <math.h>
+#include <chrono>
+#include <algorithm>
+
+#include "softsound.h"
+#include "templates.h"
+#include "c_cvars.h"
+#include "printf.h"
+#include "v_text.h"
+#include "files.h"
+#include "m_swap.h"
+#include "i_time.h"
+
+EXTERN_CVAR(Int, snd_channels)
+EXTERN_CVAR(Int, snd_samplerate)
+EXTERN_CVAR(Bool, snd_pitched)
+
+CVAR(String, snd_softwavfile, "", 0)	// empty: mix and discard
+CVAR(Int, snd_softmixms, 0, 0)			// milliseconds mixed per update, 0: follow real time
+
+#define AREA_SOUND_RADIUS  (32.f)
+
+#define PITCH_MULT (0.7937005f) /* Approx. 4 semitones lower, same as OpenAL */
+
+#define PITCH(pitch) (snd_pitched ? (pitch)/128.f : 1.f)
+
+// Sample data, converted to float when loaded.
+struct FSoftSample
+{
+	TArray<float> Data;		// interleaved frames
+	int Channels;
+	int Frequency;
+	unsigned Frames;
+	unsigned LoopStart;
+	unsigned LoopEnd;
+};
+
+struct FSoftVoice
+{
+	FSoftSample *Sample;
+	FISoundChannel *Chan;
+	double Pos;				// in sample frames
+	float Pitch;
+	float Volume;
+	FVector3 Position;
+	bool Is3D;
+	bool Area;
+	bool Looping;
+	bool Pausable;
+	bool Water;				// gets the underwater pitch
+	bool Ended;
+};
+
+//==========================================================================
+//
+// Music and other streams. The callback is run by the mixer whenever the
+// converted data runs out.
+//
+//==========================================================================
+
+class FSoftSoundStream : public SoundStream
+{
+	SoftSoundRenderer *Renderer;
+
+	SoundStreamCallback Callback = nullptr;
+	void *UserData = nullptr;
+
+	int SampleRate = 0;
+	int Flags = 0;
+	int FrameSize = 0;
+	TArray<uint8_t> Data;
+	TArray<float> Buffer;	// stereo frames converted from Data
+	double Pos = 0;			// in Buffer frames
+
+	float Volume = 1.f;
+	bool Playing = false;
+	bool Paused = false;
+
+	bool Refill()
+	{
+		// Drop what has been played already.
+		unsigned consumed = std::min(unsigned(Pos), Buffer.Size() / 2);
+		if (consumed > 0)
+		{
+			memmove(Buffer.Data(), Buffer.Data() + consumed * 2, (Buffer.Size() - consumed * 2) * sizeof(float));
+			Buffer.Resize(Buffer.Size() - consumed * 2);
+			Pos -= consumed;
+		}
+
+		if (!Callback(this, Data.Data(), Data.Size(), UserData))
+		{
+			return false;
+		}
+
+		unsigned frames = Data.Size() / FrameSize;
+		unsigned channels = (Flags & Mono) ? 1 : 2;
+		unsigned start = Buffer.Reserve(frames * 2);
+		float *out = &Buffer[start];
+		for (unsigned i = 0; i < frames * channels; i++)
+		{
+			float s;
+			if (Flags & Bits8) s = (Data[i] - 128) / 128.f;
+			else if (Flags & Float) s = ((float *)Data.Data())[i];
+			else if (Flags & Bits32) s = ((int32_t *)Data.Data())[i] / 2147483648.f;
+			else s = ((int16_t *)Data.Data())[i] / 32768.f;
+
+			if (channels == 1)
+			{
+				out[i * 2] = out[i * 2 + 1] = s;
+			}
+			else
+			{
+				out[i] = s;
+			}
+		}
+		return true;
+	}
+
+public:
+	FSoftSoundStream(SoftSoundRenderer *renderer)
+		: Renderer(renderer)
+	{
+		Renderer->Streams.Push(this);
+	}
+
+	virtual ~FSoftSoundStream()
+	{
+		Renderer->Streams.Delete(Renderer->Streams.Find(this));
+	}
+
+	bool Init(SoundStreamCallback callback, int buffbytes, int flags, int samplerate, void *userdata)
+	{
+		if (samplerate <= 0)
+		{
+			return false;
+		}
+		Callback = callback;
+		UserData = userdata;
+		SampleRate = samplerate;
+		Flags = flags;
+
+		FrameSize = (flags & Bits8) ? 1 : (flags & (Bits32 | Float)) ? 4 : 2;
+		if (!(flags & Mono)) FrameSize *= 2;
+
+		buffbytes += FrameSize - 1;
+		buffbytes -= buffbytes % FrameSize;
+		Data.Resize(buffbytes);
+		return buffbytes > 0;
+	}
+
+	virtual bool Play(bool looping, float volume)
+	{
+		SetVolume(volume);
+		if (Playing)
+			return true;
+
+		Buffer.Clear();
+		Pos = 0;
+		Playing = Refill();
+		return Playing;
+	}
+
+	virtual void Stop()
+	{
+		Playing = false;
+	}
+
+	virtual void SetVolume(float volume)
+	{
+		Volume = volume;
+	}
+
+	virtual bool SetPaused(bool paused)
+	{
+		Paused = paused;
+		return true;
+	}
+
+	virtual bool IsEnded()
+	{
+		return !Playing;
+	}
+
+	virtual FString GetStats()
+	{
+		FString stats;
+		stats.Format("%s, %uHz, %u frames buffered", !Playing ? "Stopped" : Paused ? "Paused" : "Playing",
+			SampleRate, Buffer.Size() / 2 - std::min(unsigned(Pos), Buffer.Size() / 2));
+		return stats;
+	}
+
+	void Mix(float *out, int frames, int outrate)
+	{
+		if (!Playing || Paused)
+			return;
+
+		float gain = Renderer->MusicVolume * Volume;
+		double step = double(SampleRate) / outrate;
+		for (int i = 0; i < frames; i++)
+		{
+			while (unsigned(Pos) + 1 >= Buffer.Size() / 2)
+			{
+				if (!Refill())
+				{
+					Playing = false;
+					return;
+				}
+			}
+			unsigned p = unsigned(Pos);
+			float frac = float(Pos - p);
+			const float *s = &Buffer[p * 2];
+			out[i * 2] += (s[0] + (s[2] - s[0]) * frac) * gain;
+			out[i * 2 + 1] += (s[1] + (s[3] - s[1]) * frac) * gain;
+			Pos += step;
+		}
+	}
+};
+
+//==========================================================================
+//
+// SoftSoundRenderer
+//
+//==========================================================================
+
+SoftSoundRenderer::SoftSoundRenderer()
+{
+	OutputRate = *snd_samplerate > 0 ? *snd_samplerate : 44100;
+	LastMixTime = I_nsTime();
+	if (**snd_softwavfile)
+	{
+		OpenWavFile(snd_softwavfile);
+	}
+}
+
+SoftSoundRenderer::~SoftSoundRenderer()
+{
+	// The sound engine may already be gone, so the channels are not released here.
+	// I_CloseSound unloads all samples first, which stops them.
+	for (auto voice : Voices)
+	{
+		delete voice;
+	}
+	for (auto voice : FreeVoices)
+	{
+		delete voice;
+	}
+	CloseWavFile();
+}
+
+bool SoftSoundRenderer::IsValid()
+{
+	return true;
+}
+
+void SoftSoundRenderer::SetSfxVolume(float volume)
+{
+	SfxVolume = volume;
+}
+
+void SoftSoundRenderer::SetMusicVolume(float volume)
+{
+	MusicVolume = volume;
+}
+
+float SoftSoundRenderer::GetOutputRate()
+{
+	return (float)OutputRate;
+}
+
+//==========================================================================
+//
+// Samples
+//
+//==========================================================================
+
+SoundHandle SoftSoundRenderer::LoadSoundRaw(uint8_t *sfxdata, int length, int frequency, int channels, int bits, int loopstart, int loopend)
+{
+	SoundHandle retval = { NULL };
+
+	if (length <= 0) return retval;
+
+	if ((bits != 8 && bits != -8 && bits != 16) || (channels != 1 && channels != 2) || frequency <= 0)
+	{
+		Printf("Unhandled format: %d bit, %d channel, %d hz\n", bits, channels, frequency);
+		return retval;
+	}
+
+	int samplesize = bits == 16 ? 2 : 1;
+	unsigned frames = length / (channels * samplesize);
+	if (frames == 0) return retval;
+
+	auto sample = new FSoftSample;
+	sample->Channels = channels;
+	sample->Frequency = frequency;
+	sample->Frames = frames;
+	sample->Data.Resize(frames * channels);
+	for (unsigned i = 0; i < frames * channels; i++)
+	{
+		if (bits == 16) sample->Data[i] = ((int16_t *)sfxdata)[i] / 32768.f;
+		else if (bits == 8) sample->Data[i] = (sfxdata[i] - 128) / 128.f;
+		else sample->Data[i] = (int8_t)sfxdata[i] / 128.f;
+	}
+
+	if (loopstart < 0 || unsigned(loopstart) >= frames) loopstart = 0;
+	if (loopend <= loopstart || unsigned(loopend) > frames) loopend = frames;
+	sample->LoopStart = loopstart;
+	sample->LoopEnd = loopend;
+
+	retval.data = sample;
+	return retval;
+}
+
+SoundHandle SoftSoundRenderer::LoadSound(uint8_t *sfxdata, int length)
+{
+	FDecodedSound decoded;
+	if (!S_DecodeSound(sfxdata, length, decoded))
+	{
+		SoundHandle retval = { NULL };
+		return retval;
+	}
+	return LoadSoundRaw(decoded.Data.Data(), decoded.Data.Size(), decoded.Frequency, decoded.Channels, decoded.Bits, decoded.LoopStart, decoded.LoopEnd);
+}
+
+void SoftSoundRenderer::UnloadSound(SoundHandle sfx)
+{
+	if (!sfx.data)
+		return;
+
+	auto sample = (FSoftSample *)sfx.data;
+	FSoundChan *schan = soundEngine->GetChannels();
+	while (schan)
+	{
+		FSoundChan *next = schan->NextChan;
+		if (schan->SysChannel && ((FSoftVoice *)schan->SysChannel)->Sample == sample)
+		{
+			StopChannel(schan);
+		}
+		schan = next;
+	}
+	delete sample;
+}
+
+unsigned int SoftSoundRenderer::GetMSLength(SoundHandle sfx)
+{
+	if (!sfx.data) return 0;
+	auto sample = (FSoftSample *)sfx.data;
+	return (unsigned int)(sample->Frames * 1000. / sample->Frequency);
+}
+
+unsigned int SoftSoundRenderer::GetSampleLength(SoundHandle sfx)
+{
+	if (!sfx.data) return 0;
+	return ((FSoftSample *)sfx.data)->Frames;
+}
+
+unsigned int SoftSoundRenderer::GetDataSize(SoundHandle sfx)
+{
+	if (!sfx.data) return 0;
+	return ((FSoftSample *)sfx.data)->Data.Size() * sizeof(float);
+}
+
+SoundStream *SoftSoundRenderer::CreateStream(SoundStreamCallback callback, int buffbytes, int flags, int samplerate, void *userdata)
+{
+	auto stream = new FSoftSoundStream(this);
+	if (!stream->Init(callback, buffbytes, flags, samplerate, userdata))
+	{
+		delete stream;
+		return NULL;
+	}
+	return stream;
+}
+
+//==========================================================================
+//
+// Channels
+//
+//==========================================================================
+
+FSoundChan *SoftSoundRenderer::FindLowestChannel()
+{
+	FSoundChan *schan = soundEngine->GetChannels();
+	FSoundChan *lowest = NULL;
+	while (schan)
+	{
+		if (schan->SysChannel != NULL)
+		{
+			if (!lowest || schan->Priority < lowest->Priority ||
+				(schan->Priority == lowest->Priority &&
+				schan->DistanceSqr > lowest->DistanceSqr))
+				lowest = schan;
+		}
+		schan = schan->NextChan;
+	}
+	return lowest;
+}
+
+FSoftVoice *SoftSoundRenderer::AllocVoice(int priority, float dist_sqr, bool is3d)
+{
+	if ((int)Voices.Size() >= *snd_channels)
+	{
+		FSoundChan *lowest = FindLowestChannel();
+		if (lowest && (!is3d || lowest->Priority < priority ||
+			(lowest->Priority == priority && lowest->DistanceSqr > dist_sqr)))
+		{
+			StopChannel(lowest);
+		}
+		if ((int)Voices.Size() >= *snd_channels)
+			return nullptr;
+	}
+
+	FSoftVoice *voice;
+	if (FreeVoices.Pop(voice)) return voice;
+	return new FSoftVoice;
+}
+
+FISoundChannel *SoftSoundRenderer::StartVoice(FSoftVoice *voice, SoundHandle sfx, float vol, int pitch, int chanflags, FISoundChannel *reuse_chan, float startTime)
+{
+	auto sample = (FSoftSample *)sfx.data;
+	voice->Sample = sample;
+	voice->Volume = vol;
+	voice->Pitch = PITCH(pitch);
+	voice->Looping = !!(chanflags & SNDF_LOOP);
+	voice->Pausable = !(chanflags & SNDF_NOPAUSE);
+	voice->Water = !(chanflags & SNDF_NOREVERB);
+	voice->Area = !!(chanflags & SNDF_AREA);
+	voice->Ended = false;
+
+	float length = float(sample->Frames) / sample->Frequency;
+	float offset;
+	if (!reuse_chan || reuse_chan->StartTime == 0)
+	{
+		offset = voice->Looping ? (length > 0 ? fmodf(startTime, length) : 0) : clamp<float>(startTime, 0.f, length);
+	}
+	else if (chanflags & SNDF_ABSTIME)
+	{
+		offset = float(reuse_chan->StartTime) / sample->Frequency;
+	}
+	else
+	{
+		offset = std::chrono::duration_cast<std::chrono::duration<float>>(
+			std::chrono::steady_clock::now().time_since_epoch() -
+			std::chrono::steady_clock::time_point::duration(reuse_chan->StartTime)
+		).count();
+		if (offset < 0.f) offset = 0.f;
+	}
+	voice->Pos = double(offset) * sample->Frequency;
+
+	Voices.Push(voice);
+	PeakVoices = std::max<int>(PeakVoices, Voices.Size());
+
+	FISoundChannel *chan = reuse_chan;
+	if (!chan) chan = soundEngine->GetChannel(voice);
+	else chan->SysChannel = voice;
+	voice->Chan = chan;
+	return chan;
+}
+
+FISoundChannel *SoftSoundRenderer::StartSound(SoundHandle sfx, float vol, int pitch, int chanflags, FISoundChannel *reuse_chan, float startTime)
+{
+	if (!sfx.data)
+		return NULL;
+
+	FSoftVoice *voice = AllocVoice(0, 0.f, false);
+	if (voice == nullptr)
+		return NULL;
+
+	voice->Is3D = false;
+	FISoundChannel *chan = StartVoice(voice, sfx, vol, pitch, chanflags, reuse_chan, startTime);
+
+	chan->Rolloff.RolloffType = ROLLOFF_Log;
+	chan->Rolloff.RolloffFactor = 0.f;
+	chan->Rolloff.MinDistance = 1.f;
+	chan->DistanceSqr = 0.f;
+	chan->ManualRolloff = false;
+	return chan;
+}
+
+FISoundChannel *SoftSoundRenderer::StartSound3D(SoundHandle sfx, SoundListener *listener, float vol,
+	FRolloffInfo *rolloff, float distscale, int pitch, int priority, const FVector3 &pos, const FVector3 &vel,
+	int channum, int chanflags, FISoundChannel *reuse_chan, float startTime)
+{
+	if (!sfx.data)
+		return NULL;
+
+	float dist_sqr = (float)(pos - listener->position).LengthSquared();
+	FSoftVoice *voice = AllocVoice(priority, dist_sqr, true);
+	if (voice == nullptr)
+		return NULL;
+
+	voice->Is3D = true;
+	voice->Position = pos;
+	FISoundChannel *chan = StartVoice(voice, sfx, vol, pitch, chanflags, reuse_chan, startTime);
+
+	// All rolloff types are done by the mixer.
+	chan->Rolloff = *rolloff;
+	chan->DistanceScale = distscale;
+	chan->DistanceSqr = dist_sqr;
+	chan->ManualRolloff = true;
+	return chan;
+}
+
+void SoftSoundRenderer::ChannelVolume(FISoundChannel *chan, float volume)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return;
+	((FSoftVoice *)chan->SysChannel)->Volume = volume;
+}
+
+void SoftSoundRenderer::ChannelPitch(FISoundChannel *chan, float pitch)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return;
+	((FSoftVoice *)chan->SysChannel)->Pitch = std::max(pitch, 0.0001f);
+}
+
+void SoftSoundRenderer::StopChannel(FISoundChannel *chan)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return;
+
+	auto voice = (FSoftVoice *)chan->SysChannel;
+	// Release first, so it can be properly marked as evicted if it's being killed
+	soundEngine->ChannelEnded(chan);
+
+	Voices.Delete(Voices.Find(voice));
+	FreeVoices.Push(voice);
+
+	if (!(chan->ChanFlags & CHANF_EVICTED))
+		soundEngine->SoundDone(chan);
+}
+
+unsigned int SoftSoundRenderer::GetPosition(FISoundChannel *chan)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return 0;
+	return (unsigned int)((FSoftVoice *)chan->SysChannel)->Pos;
+}
+
+void SoftSoundRenderer::MarkStartTime(FISoundChannel *chan, float startTime)
+{
+	using namespace std::chrono;
+	auto startTimeDuration = duration<double>(startTime);
+	auto diff = steady_clock::now().time_since_epoch() - startTimeDuration;
+	chan->StartTime = static_cast<uint64_t>(duration_cast<nanoseconds>(diff).count());
+}
+
+float SoftSoundRenderer::GetAudibility(FISoundChannel *chan)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return 0.f;
+
+	float volume = SfxVolume * ((FSoftVoice *)chan->SysChannel)->Volume;
+	return volume * soundEngine->GetRolloff(&chan->Rolloff, sqrtf(chan->DistanceSqr) * chan->DistanceScale);
+}
+
+void SoftSoundRenderer::Sync(bool sync)
+{
+	SyncPaused = sync;
+}
+
+void SoftSoundRenderer::SetSfxPaused(bool paused, int slot)
+{
+	if (paused) SFXPaused |= 1 << slot;
+	else SFXPaused &= ~(1 << slot);
+}
+
+void SoftSoundRenderer::SetInactive(SoundRenderer::EInactiveState state)
+{
+	Inactive = state;
+}
+
+void SoftSoundRenderer::UpdateSoundParams3D(SoundListener *listener, FISoundChannel *chan, bool areasound, const FVector3 &pos, const FVector3 &vel)
+{
+	if (chan == NULL || chan->SysChannel == NULL)
+		return;
+
+	chan->DistanceSqr = (float)(pos - listener->position).LengthSquared();
+	auto voice = (FSoftVoice *)chan->SysChannel;
+	voice->Position = pos;
+	voice->Area = areasound;
+}
+
+void SoftSoundRenderer::UpdateListener(SoundListener *listener)
+{
+	if (!listener->valid)
+		return;
+
+	Listener = *listener;
+	const ReverbContainer *env = listener->Environment;
+	if (!env) env = DefaultEnvironments[0];
+	WasInWater = listener->underwater || (env && env->SoftwareWater);
+}
+
+//==========================================================================
+//
+// Mixing
+//
+//==========================================================================
+
+void SoftSoundRenderer::MixVoice(FSoftVoice *voice, float *out, int frames)
+{
+	auto sample = voice->Sample;
+	auto chan = voice->Chan;
+	float gain = SfxVolume * voice->Volume;
+	float pan = 0;
+
+	if (voice->Is3D)
+	{
+		FVector3 dir = voice->Position - Listener.position;
+		float dist = (float)dir.Length();
+		gain *= soundEngine->GetRolloff(&chan->Rolloff, dist * chan->DistanceScale);
+		if (dist >= 0.0004f)
+		{
+			// Right of the listener is positive.
+			pan = float((dir.X * sinf(Listener.angle) - dir.Z * cosf(Listener.angle)) / dist);
+			if (voice->Area && dist < AREA_SOUND_RADIUS) pan *= dist / AREA_SOUND_RADIUS;
+		}
+	}
+	if (Inactive != INACTIVE_Active || gain <= 0.f)
+	{
+		gain = 0.f;
+	}
+
+	float gainl = gain, gainr = gain;
+	if (sample->Channels == 1)
+	{
+		// constant power panning
+		gainl *= sqrtf((1.f - pan) * 0.5f) * 1.41421356f;
+		gainr *= sqrtf((1.f + pan) * 0.5f) * 1.41421356f;
+	}
+
+	float pitch = voice->Pitch;
+	if (WasInWater && voice->Water && !(chan->ChanFlags & CHANF_UI)) pitch *= PITCH_MULT;
+	double step = double(pitch) * sample->Frequency / OutputRate;
+
+	const float *data = sample->Data.Data();
+	const unsigned channels = sample->Channels;
+	const double end = voice->Looping ? sample->LoopEnd : sample->Frames;
+	double pos = voice->Pos;
+
+	for (int i = 0; i < frames; i++)
+	{
+		if (pos >= end)
+		{
+			if (!voice->Looping)
+			{
+				voice->Ended = true;
+				break;
+			}
+			pos = sample->LoopStart + fmod(pos - sample->LoopStart, end - sample->LoopStart);
+		}
+		unsigned p = unsigned(pos);
+		unsigned next = p + 1 < unsigned(end) ? p + 1 : voice->Looping ? sample->LoopStart : p;
+		float frac = float(pos - p);
+
+		const float *s0 = data + p * channels;
+		const float *s1 = data + next * channels;
+		if (channels == 1)
+		{
+			float s = s0[0] + (s1[0] - s0[0]) * frac;
+			out[i * 2] += s * gainl;
+			out[i * 2 + 1] += s * gainr;
+		}
+		else
+		{
+			out[i * 2] += (s0[0] + (s1[0] - s0[0]) * frac) * gainl;
+			out[i * 2 + 1] += (s0[1] + (s1[1] - s0[1]) * frac) * gainr;
+		}
+		pos += step;
+	}
+	voice->Pos = pos;
+}
+
+void SoftSoundRenderer::Mix(int frames)
+{
+	uint64_t start = I_nsTime();
+
+	MixBuffer.Resize(frames * 2);
+	memset(MixBuffer.Data(), 0, MixBuffer.Size() * sizeof(float));
+
+	for (auto voice : Voices)
+	{
+		if (SyncPaused || (voice->Pausable && SFXPaused)) continue;
+		MixVoice(voice, MixBuffer.Data(), frames);
+	}
+	for (auto stream : Streams)
+	{
+		stream->Mix(MixBuffer.Data(), frames, OutputRate);
+	}
+	WriteOutput(MixBuffer.Data(), frames);
+
+	FramesMixed += frames;
+	MixNs += I_nsTime() - start;
+}
+
+void SoftSoundRenderer::UpdateSounds()
+{
+	uint64_t now = I_nsTime();
+	int frames;
+
+	if (snd_softmixms > 0)
+	{
+		frames = int(int64_t(OutputRate) * snd_softmixms / 1000);
+		LastMixTime = now;
+	}
+	else
+	{
+		uint64_t elapsed = now - LastMixTime;
+		// Don't try to catch up after a long stall, e.g. while loading a level.
+		if (elapsed > 250'000'000)
+		{
+			elapsed = 250'000'000;
+			LastMixTime = now - elapsed;
+		}
+		frames = int(elapsed * OutputRate / 1'000'000'000);
+		LastMixTime += uint64_t(frames) * 1'000'000'000 / OutputRate;
+	}
+
+	if (frames > 0 && Inactive != INACTIVE_Complete)
+	{
+		Mix(frames);
+	}
+
+	// Release channels that have finished playing.
+	for (unsigned i = Voices.Size(); i-- > 0; )
+	{
+		if (i < Voices.Size() && Voices[i]->Ended)
+		{
+			StopChannel(Voices[i]->Chan);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Output. Without a WAV file the mix is converted but not kept, so that
+// the cost is the same either way.
+//
+//==========================================================================
+
+void SoftSoundRenderer::WriteOutput(const float *buffer, int frames)
+{
+	OutBuffer.Resize(frames * 2);
+	for (int i = 0; i < frames * 2; i++)
+	{
+		OutBuffer[i] = (int16_t)LittleShort((int16_t)clamp<float>(buffer[i] * 32767.f, -32768.f, 32767.f));
+	}
+	if (WavFile != nullptr)
+	{
+		WavFile->Write(OutBuffer.Data(), OutBuffer.Size() * sizeof(int16_t));
+		WavBytes += OutBuffer.Size() * sizeof(int16_t);
+	}
+}
+
+void SoftSoundRenderer::OpenWavFile(const char *filename)
+{
+	WavFile = FileWriter::Open(filename);
+	if (WavFile == nullptr)
+	{
+		Printf(TEXTCOLOR_RED "Could not open %s for writing\n", filename);
+		return;
+	}
+	WavName = filename;
+	WavBytes = 0;
+
+	// The sizes get filled in when the file is closed.
+	uint8_t header[44] = { 'R','I','F','F', 0,0,0,0, 'W','A','V','E', 'f','m','t',' ' };
+	auto put32 = [&](int ofs, uint32_t v) { for (int i = 0; i < 4; i++) header[ofs + i] = uint8_t(v >> (i * 8)); };
+	auto put16 = [&](int ofs, uint16_t v) { header[ofs] = uint8_t(v); header[ofs + 1] = uint8_t(v >> 8); };
+	put32(16, 16);					// fmt chunk size
+	put16(20, 1);					// PCM
+	put16(22, 2);					// channels
+	put32(24, OutputRate);
+	put32(28, OutputRate * 4);		// bytes per second
+	put16(32, 4);					// block align
+	put16(34, 16);					// bits per sample
+	memcpy(header + 36, "data", 4);
+	WavFile->Write(header, sizeof(header));
+}
+
+void SoftSoundRenderer::CloseWavFile()
+{
+	if (WavFile == nullptr)
+		return;
+
+	uint32_t riffsize = LittleLong(WavBytes + 36);
+	uint32_t datasize = LittleLong(WavBytes);
+	WavFile->Seek(4, SEEK_SET);
+	WavFile->Write(&riffsize, 4);
+	WavFile->Seek(40, SEEK_SET);
+	WavFile->Write(&datasize, 4);
+	delete WavFile;
+	WavFile = nullptr;
+}
+
+//==========================================================================
+//
+// Status
+//
+//==========================================================================
+
+void SoftSoundRenderer::PrintStatus()
+{
+	Printf("Software mixer, sample rate: " TEXTCOLOR_BLUE "%d" TEXTCOLOR_NORMAL "hz\n", OutputRate);
+	Printf("Output: " TEXTCOLOR_ORANGE "%s\n", WavFile ? WavName.GetChars() : "discarded");
+	if (snd_softmixms > 0) Printf("Mixing %d ms per update\n", *snd_softmixms);
+}
+
+void SoftSoundRenderer::PrintDriversList()
+{
+	Printf("Software mixer uses no drivers.\n");
+}
+
+FString SoftSoundRenderer::GatherStats()
+{
+	double seconds = double(FramesMixed) / OutputRate;
+	double ms = MixNs / 1e6;
+
+	FString out;
+	out.Format("%u voices (" TEXTCOLOR_YELLOW "%d" TEXTCOLOR_NORMAL " peak), %u streams, mixed %.1f s in %.1f ms (" TEXTCOLOR_YELLOW "%.2f%%" TEXTCOLOR_NORMAL " of real time)",
+		Voices.Size(), PeakVoices, Streams.Size(), seconds, ms, seconds > 0 ? ms / (seconds * 10.) : 0.);
+	return out;
+}
@@ -0,0 +1,124 @@
+#ifndef SOFTSOUND_H
+#define SOFTSOUND_H
+
+#include "i_sound.h"
+#include "s_soundinternal.h"
+
+//==========================================================================
+//
+// Software mixer
+//
+// A sound renderer that needs no audio device. UpdateSounds mixes the
+// playing channels and music streams for the time that has passed since
+// the last update, or for snd_softmixms per update if that is set, and the
+// result is either discarded or written to the WAV file named by
+// snd_softwavfile. That file is overwritten each time the renderer
+// starts. The whole sound path, mixing included, can then run on machines
+// without audio hardware, e.g. for benchmarks and regression runs.
+//
+// Selected with snd_backend "software" or -softsound. There is no reverb;
+// underwater only lowers the pitch, like OpenAL without EFX.
+//
+//==========================================================================
+
+struct FSoftSample;
+struct FSoftVoice;
+class FSoftSoundStream;
+class FileWriter;
+
+class SoftSoundRenderer : public SoundRenderer
+{
+public:
+	SoftSoundRenderer();
+	virtual ~SoftSoundRenderer();
+
+	virtual void SetSfxVolume(float volume);
+	virtual void SetMusicVolume(float volume);
+	virtual SoundHandle LoadSound(uint8_t *sfxdata, int length);
+	virtual SoundHandle LoadSoundRaw(uint8_t *sfxdata, int length, int frequency, int channels, int bits, int loopstart, int loopend = -1);
+	virtual void UnloadSound(SoundHandle sfx);
+	virtual unsigned int GetMSLength(SoundHandle sfx);
+	virtual unsigned int GetSampleLength(SoundHandle sfx);
+	virtual unsigned int GetDataSize(SoundHandle sfx);
+	virtual float GetOutputRate();
+
+	// Streaming sounds.
+	virtual SoundStream *CreateStream(SoundStreamCallback callback, int buffbytes, int flags, int samplerate, void *userdata);
+
+	// Starts a sound.
+	virtual FISoundChannel *StartSound(SoundHandle sfx, float vol, int pitch, int chanflags, FISoundChannel *reuse_chan, float startTime);
+	virtual FISoundChannel *StartSound3D(SoundHandle sfx, SoundListener *listener, float vol, FRolloffInfo *rolloff, float distscale, int pitch, int priority, const FVector3 &pos, const FVector3 &vel, int channum, int chanflags, FISoundChannel *reuse_chan, float startTime);
+
+	// Changes a channel's volume.
+	virtual void ChannelVolume(FISoundChannel *chan, float volume);
+
+	// Changes a channel's pitch.
+	virtual void ChannelPitch(FISoundChannel *chan, float pitch);
+
+	// Stops a sound channel.
+	virtual void StopChannel(FISoundChannel *chan);
+
+	// Returns position of sound on this channel, in samples.
+	virtual unsigned int GetPosition(FISoundChannel *chan);
+
+	// Synchronizes following sound startups.
+	virtual void Sync(bool sync);
+
+	// Pauses or resumes all sound effect channels.
+	virtual void SetSfxPaused(bool paused, int slot);
+
+	// Pauses or resumes *every* channel, including environmental reverb.
+	virtual void SetInactive(EInactiveState state);
+
+	// Updates the volume, separation, and pitch of a sound channel.
+	virtual void UpdateSoundParams3D(SoundListener *listener, FISoundChannel *chan, bool areasound, const FVector3 &pos, const FVector3 &vel);
+
+	virtual void UpdateListener(SoundListener *);
+	virtual void UpdateSounds();
+
+	virtual void MarkStartTime(FISoundChannel*, float startTime);
+	virtual float GetAudibility(FISoundChannel*);
+
+	virtual bool IsValid();
+	virtual void PrintStatus();
+	virtual void PrintDriversList();
+	virtual FString GatherStats();
+
+private:
+	friend class FSoftSoundStream;
+
+	FISoundChannel *StartVoice(FSoftVoice *voice, SoundHandle sfx, float vol, int pitch, int chanflags, FISoundChannel *reuse_chan, float startTime);
+	FSoftVoice *AllocVoice(int priority, float dist_sqr, bool is3d);
+	FSoundChan *FindLowestChannel();
+	void Mix(int frames);
+	void MixVoice(FSoftVoice *voice, float *out, int frames);
+	void WriteOutput(const float *buffer, int frames);
+	void OpenWavFile(const char *filename);
+	void CloseWavFile();
+
+	int OutputRate;
+	float SfxVolume = 1.f;
+	float MusicVolume = 1.f;
+	int SFXPaused = 0;
+	bool SyncPaused = false;
+	EInactiveState Inactive = INACTIVE_Active;
+	bool WasInWater = false;
+	SoundListener Listener{};
+
+	TArray<FSoftVoice *> Voices;
+	TArray<FSoftVoice *> FreeVoices;
+	TArray<FSoftSoundStream *> Streams;
+	TArray<float> MixBuffer;
+	TArray<int16_t> OutBuffer;
+
+	uint64_t LastMixTime = 0;
+	uint64_t FramesMixed = 0;
+	uint64_t MixNs = 0;
+	int PeakVoices = 0;
+
+	FileWriter *WavFile = nullptr;
+	FString WavName;
+	uint32_t WavBytes = 0;
+};
+
+#endif
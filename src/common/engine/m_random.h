@@ -50,9 +50,28 @@ public:
 
 	int Seed() const
 	{
-		return sfmt.u[0] + idx;
+		if (BatchEnd == 0)
+		{
+			return sfmt.u[0] + idx;
+		}
+		int block = BatchBlock();
+		return Batch.u[block * SFMT::N32] + BatchPos - block * SFMT::N32;
+	}
+
+	// Numbers are drawn from a batch of several state blocks that are
+	// generated in one go, which gives exactly the same sequence as
+	// drawing them from the SFMT state one at a time.
+	unsigned int GenRand32()
+	{
+		if (BatchPos >= BatchEnd)
+		{
+			FillBatch();
+		}
+		return Batch.u[BatchPos++];
 	}
 
+	uint64_t GenRand64();
+
 	// Returns a random number in the range [0,255]
 	int operator()()
 	{
@@ -176,13 +195,37 @@ public:
 	static void StaticPrintSeeds ();
 #endif
 
+	// For walking all RNGs, e.g. to fingerprint the game state.
+	static FRandom *StaticFirstRNG() { return RNGList; }
+	FRandom *NextRNG() const { return Next; }
+	uint32_t GetNameCRC() const { return NameCRC; }
+
 private:
+	enum { BatchBlocks = 8 };
+
+	int BatchBlock() const
+	{
+		return BatchPos > 0 ? (BatchPos - 1) / SFMT::N32 : 0;
+	}
+	void FillBatch();
+	void SyncState();
+
 #ifndef NDEBUG
 	const char *Name;
 #endif
 	FRandom *Next;
 	uint32_t NameCRC;
 
+	// The state blocks following sfmt. BatchEnd is 0 while sfmt and idx
+	// are current; otherwise sfmt is the last block in the batch.
+	union
+	{
+		w128_t w128[BatchBlocks * SFMT::N];
+		unsigned int u[BatchBlocks * SFMT::N32];
+	} Batch;
+	int BatchPos = 0;
+	int BatchEnd = 0;
+
 	static FRandom *RNGList;
 };
 
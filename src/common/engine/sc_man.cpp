@@ -1333,6 +1333,7 @@ int FScriptPosition::WarnCounter;
 int FScriptPosition::Developer;
 bool FScriptPosition::StrictErrors;	// makes all OPTERROR messages real errors.
 bool FScriptPosition::errorout;		// call I_Error instead of printing the error itself.
+thread_local TArray<FScriptMessage> *FScriptPosition::Deferred;
 
 
 FScriptPosition::FScriptPosition(FString fname, int line)
@@ -1368,12 +1369,6 @@ void FScriptPosition::Message (int severity, const char *message, ...) const
 	if (severity == MSG_DEBUGERROR && Developer < DMSG_ERROR) return;
 	if (severity == MSG_DEBUGWARN && Developer < DMSG_WARNING) return;
 	if (severity == MSG_DEBUGMSG && Developer < DMSG_NOTIFY) return;
-	if (severity == MSG_OPTERROR)
-	{
-		severity = StrictErrors? MSG_ERROR : MSG_WARNING;
-	}
-	// This is mainly for catching the error with an exception handler.
-	if (severity == MSG_ERROR && errorout) severity = MSG_FATAL;
 
 	if (message == NULL)
 	{
@@ -1386,6 +1381,33 @@ void FScriptPosition::Message (int severity, const char *message, ...) const
 		composed.VFormat (message, arglist);
 		va_end (arglist);
 	}
+
+	if (Deferred != nullptr)
+	{
+		Deferred->Push({ *this, severity, composed });
+		return;
+	}
+	Report(severity, composed);
+}
+
+//==========================================================================
+//
+// FScriptPosition::Report
+//
+// Counts and prints a message that has already been filtered and
+// formatted by Message.
+//
+//==========================================================================
+
+void FScriptPosition::Report(int severity, const FString &composed) const
+{
+	if (severity == MSG_OPTERROR)
+	{
+		severity = StrictErrors? MSG_ERROR : MSG_WARNING;
+	}
+	// This is mainly for catching the error with an exception handler.
+	if (severity == MSG_ERROR && errorout) severity = MSG_FATAL;
+
 	const char *type = "";
 	const char *color;
 	int level = PRINT_HIGH;
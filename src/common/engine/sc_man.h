@@ -266,6 +266,8 @@ enum
 //
 //==========================================================================
 
+struct FScriptMessage;
+
 struct FScriptPosition
 {
 	static int WarnCounter;
@@ -273,6 +275,7 @@ struct FScriptPosition
 	static bool StrictErrors;
 	static int Developer;
 	static bool errorout;
+	static thread_local TArray<FScriptMessage> *Deferred;	// if set, messages get collected here instead of being printed.
 	FName FileName;
 	int ScriptLine;
 
@@ -287,6 +290,7 @@ struct FScriptPosition
 	FScriptPosition &operator=(const FScriptPosition &other) = default;
 	FScriptPosition &operator=(FScanner &sc);
 	void Message(int severity, const char *message,...) const GCCPRINTF(3,4);
+	void Report(int severity, const FString &composed) const;
 	static void ResetErrorCounter()
 	{
 		WarnCounter = 0;
@@ -294,6 +298,13 @@ struct FScriptPosition
 	}
 };
 
+struct FScriptMessage
+{
+	FScriptPosition Pos;
+	int Severity;
+	FString Text;
+};
+
 int ParseHex(const char* hex, FScriptPosition* sc);
 
 
@@ -377,6 +377,109 @@ void FSerializer::EndArray()
 	}
 }
 
+//==========================================================================
+//
+// Sparse arrays elide all elements that were written as empty objects.
+// Each run of elided elements is replaced by a single integer holding
+// its length. A regular array of objects is therefore also a valid
+// sparse array which allows reading data written by older versions.
+//
+//==========================================================================
+
+bool FSerializer::BeginSparseArray(const char *name)
+{
+	if (!BeginArray(name)) return false;
+	if (isWriting())
+	{
+		assert(w->mSparseDepth == -1 && "sparse arrays cannot be nested");
+		w->mSparseDepth = w->mDepth;
+	}
+	return true;
+}
+
+//==========================================================================
+//
+//
+//
+//==========================================================================
+
+void FSerializer::EndSparseArray()
+{
+	if (isWriting())
+	{
+		// A trailing run must be written so that the reader knows the array's size.
+		w->WriteSkipped();
+		w->mSparseDepth = -1;
+	}
+	EndArray();
+}
+
+//==========================================================================
+//
+// Returns the number of elements the sparse array represents.
+//
+//==========================================================================
+
+static unsigned CountSparse(const rapidjson::Value &array)
+{
+	unsigned size = 0;
+	for (auto &val : array.GetArray())
+	{
+		size += val.IsUint() ? val.GetUint() : 1;
+	}
+	return size;
+}
+
+unsigned FSerializer::SparseArraySize()
+{
+	if (r != nullptr && r->mObjects.Last().mObject->IsArray())
+	{
+		return CountSparse(*r->mObjects.Last().mObject);
+	}
+	return 0;
+}
+
+//==========================================================================
+//
+// Sparse arrays take their elided elements from the defaults, so a stored
+// array of a different size cannot be restored.
+//
+//==========================================================================
+
+bool FSerializer::CheckSparseSize(const char *name, unsigned expected)
+{
+	unsigned size = SparseArraySize();
+	if (size == expected) return true;
+	Printf(TEXTCOLOR_RED "Array '%s' has %u elements, expected %u\n", name, size, expected);
+	mErrors++;
+	return false;
+}
+
+//==========================================================================
+//
+// If the next stored value is a run of elided elements this consumes it
+// and returns the run's length. Otherwise it returns 0.
+//
+//==========================================================================
+
+unsigned FSerializer::SparseSkip()
+{
+	if (r != nullptr)
+	{
+		FJSONObject &obj = r->mObjects.Last();
+		if (obj.mObject->IsArray() && (unsigned)obj.mIndex < obj.mObject->Size())
+		{
+			auto &val = (*obj.mObject)[obj.mIndex];
+			if (val.IsUint())
+			{
+				obj.mIndex++;
+				return val.GetUint();
+			}
+		}
+	}
+	return 0;
+}
+
 //==========================================================================
 //
 // Special handler for script numbers
@@ -546,6 +649,22 @@ unsigned FSerializer::GetSize(const char *group)
 	return val->Size();
 }
 
+//==========================================================================
+//
+// Same for arrays written by SerializeSparse.
+//
+//==========================================================================
+
+unsigned FSerializer::GetSparseSize(const char *group)
+{
+	if (isWriting()) return -1;	// we do not know this when writing.
+
+	const rapidjson::Value *val = r->FindKey(group);
+	if (!val) return 0;
+	if (!val->IsArray()) return -1;
+	return CountSparse(*val);
+}
+
 //==========================================================================
 //
 // gets the key pointed to by the iterator, caches its value
@@ -721,19 +840,32 @@ const char *FSerializer::GetOutput(unsigned *len)
 FCompressedBuffer FSerializer::GetCompressedOutput()
 {
 	if (isReading()) return{ 0,0,0,0,0,nullptr };
-	FCompressedBuffer buff;
 	WriteObjects();
 	EndObject();
-	buff.mSize = (unsigned)w->mOutString.GetSize();
+	return CompressBuffer(w->mOutString.GetString(), (unsigned)w->mOutString.GetSize());
+}
+
+//==========================================================================
+//
+// Creates a zip-compatible deflated copy of the given data.
+// This does not access any serializer state so it may be called
+// from a worker thread on output previously retrieved with GetOutput.
+//
+//==========================================================================
+
+FCompressedBuffer FSerializer::CompressBuffer(const char *data, unsigned size)
+{
+	FCompressedBuffer buff;
+	buff.mSize = size;
 	buff.mZipFlags = 0;
-	buff.mCRC32 = crc32(0, (const Bytef*)w->mOutString.GetString(), buff.mSize);
+	buff.mCRC32 = crc32(0, (const Bytef*)data, buff.mSize);
 
 	uint8_t *compressbuf = new uint8_t[buff.mSize+1];
 
 	z_stream stream;
 	int err;
 
-	stream.next_in = (Bytef *)w->mOutString.GetString();
+	stream.next_in = (Bytef *)data;
 	stream.avail_in = buff.mSize;
 	stream.next_out = (Bytef*)compressbuf;
 	stream.avail_out = buff.mSize;
@@ -767,7 +899,9 @@ FCompressedBuffer FSerializer::GetCompressedOutput()
 	}
 
 error:
-	memcpy(compressbuf, w->mOutString.GetString(), buff.mSize + 1);
+	memcpy(compressbuf, data, buff.mSize);
+	compressbuf[buff.mSize] = 0;
+	buff.mBuffer = (char*)compressbuf;
 	buff.mCompressedSize = buff.mSize;
 	buff.mMethod = METHOD_STORED;
 	return buff;
@@ -87,10 +87,17 @@ public:
 	void EndObject();
 	bool BeginArray(const char *name);
 	void EndArray();
+	bool BeginSparseArray(const char *name);
+	void EndSparseArray();
+	unsigned SparseArraySize();
+	bool CheckSparseSize(const char *name, unsigned expected);
+	unsigned SparseSkip();
 	unsigned GetSize(const char *group);
+	unsigned GetSparseSize(const char *group);
 	const char *GetKey();
 	const char *GetOutput(unsigned *len = nullptr);
 	FCompressedBuffer GetCompressedOutput();
+	static FCompressedBuffer CompressBuffer(const char *data, unsigned size);
 	// The sprite serializer is a special case because it is needed by the VM to handle its 'spriteid' type.
 	virtual FSerializer &Sprite(const char *key, int32_t &spritenum, int32_t *def);
 	// This is only needed by the type system.
@@ -269,6 +276,62 @@ FSerializer &Serialize(FSerializer &arc, const char *key, TArray<T, TT> &value,
 	return arc;
 }
 
+//==========================================================================
+//
+// Like the above, but only writes the elements that differ from the
+// defaults. This is meant for the level's sectors, lines and sides where
+// most elements never change and would otherwise be written as '{}'.
+//
+//==========================================================================
+
+template<class T, class TT>
+FSerializer &SerializeSparse(FSerializer &arc, const char *key, TArray<T, TT> &value, TArray<T, TT> &def)
+{
+	if (arc.isWriting())
+	{
+		if (save_full || value.Size() != def.Size())
+		{
+			return Serialize(arc, key, value, save_full ? nullptr : &def);
+		}
+		if (value.Size() == 0 && key) return arc;	// do not save empty arrays
+		arc.BeginSparseArray(key);
+		for (unsigned i = 0; i < value.Size(); i++)
+		{
+			Serialize(arc, nullptr, value[i], &def[i]);
+		}
+		arc.EndSparseArray();
+	}
+	else
+	{
+		if (!arc.BeginSparseArray(key))
+		{
+			value.Clear();
+			return arc;
+		}
+		// Elided elements are taken from the defaults, and the element
+		// serializers need them for the rest as well.
+		if (!arc.CheckSparseSize(key, def.Size()))
+		{
+			arc.EndSparseArray();
+			return arc;
+		}
+		value.Resize(def.Size());
+		for (unsigned i = 0; i < value.Size(); )
+		{
+			unsigned skip = arc.SparseSkip();
+			if (skip > 0)
+			{
+				i += skip;
+				continue;
+			}
+			Serialize(arc, nullptr, value[i], &def[i]);
+			i++;
+		}
+		arc.EndSparseArray();
+	}
+	return arc;
+}
+
 template<class T>
 FSerializer& Serialize(FSerializer& arc, const char* key, TPointer<T>& value, TPointer<T>* def)
 {
@@ -42,6 +42,12 @@ struct FWriter
 	rapidjson::StringBuffer mOutString;
 	TArray<DObject *> mDObjects;
 	TMap<DObject *, int> mObjectMap;
+
+	// State for writing sparse arrays, see FSerializer::BeginSparseArray.
+	int mDepth = 0;
+	int mSparseDepth = -1;		// nesting depth of the sparse array's elements.
+	bool mElementPending = false;	// an element was started but nothing has been written into it yet.
+	int mSkipped = 0;			// number of consecutive elided elements not yet written out.
 	
 	FWriter(bool pretty)
 	{
@@ -69,44 +75,91 @@ struct FWriter
 		return mInObject.Size() > 0 && mInObject.Last();
 	}
 
+	void WriteSkipped()
+	{
+		if (mSkipped > 0)
+		{
+			if (mWriter1) mWriter1->Int(mSkipped);
+			else if (mWriter2) mWriter2->Int(mSkipped);
+			mSkipped = 0;
+		}
+	}
+
+	// Called before anything gets written. If this is the first content
+	// of a sparse array element, the element must be emitted after all.
+	void BeginValue()
+	{
+		if (mElementPending)
+		{
+			mElementPending = false;
+			WriteSkipped();
+			if (mWriter1) mWriter1->StartObject();
+			else if (mWriter2) mWriter2->StartObject();
+		}
+		else if (mDepth == mSparseDepth)
+		{
+			WriteSkipped();
+		}
+	}
+
 	void StartObject()
 	{
+		if (mDepth++ == mSparseDepth)
+		{
+			// Defer this until we know the element is not empty.
+			mElementPending = true;
+			return;
+		}
+		BeginValue();
 		if (mWriter1) mWriter1->StartObject();
 		else if (mWriter2) mWriter2->StartObject();
 	}
 
 	void EndObject()
 	{
+		if (--mDepth == mSparseDepth && mElementPending)
+		{
+			// Nothing was written so the element can be elided.
+			mElementPending = false;
+			mSkipped++;
+			return;
+		}
 		if (mWriter1) mWriter1->EndObject();
 		else if (mWriter2) mWriter2->EndObject();
 	}
 
 	void StartArray()
 	{
+		BeginValue();
+		mDepth++;
 		if (mWriter1) mWriter1->StartArray();
 		else if (mWriter2) mWriter2->StartArray();
 	}
 
 	void EndArray()
 	{
+		mDepth--;
 		if (mWriter1) mWriter1->EndArray();
 		else if (mWriter2) mWriter2->EndArray();
 	}
 
 	void Key(const char *k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Key(k);
 		else if (mWriter2) mWriter2->Key(k);
 	}
 
 	void Null()
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Null();
 		else if (mWriter2) mWriter2->Null();
 	}
 
 	void StringU(const char *k, bool encode)
 	{
+		BeginValue();
 		if (encode) k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
@@ -114,6 +167,7 @@ struct FWriter
 
 	void String(const char *k)
 	{
+		BeginValue();
 		k = StringToUnicode(k);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
@@ -121,6 +175,7 @@ struct FWriter
 
 	void String(const char *k, int size)
 	{
+		BeginValue();
 		k = StringToUnicode(k, size);
 		if (mWriter1) mWriter1->String(k);
 		else if (mWriter2) mWriter2->String(k);
@@ -128,36 +183,42 @@ struct FWriter
 
 	void Bool(bool k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Bool(k);
 		else if (mWriter2) mWriter2->Bool(k);
 	}
 
 	void Int(int32_t k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Int(k);
 		else if (mWriter2) mWriter2->Int(k);
 	}
 
 	void Int64(int64_t k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Int64(k);
 		else if (mWriter2) mWriter2->Int64(k);
 	}
 
 	void Uint(uint32_t k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Uint(k);
 		else if (mWriter2) mWriter2->Uint(k);
 	}
 
 	void Uint64(int64_t k)
 	{
+		BeginValue();
 		if (mWriter1) mWriter1->Uint64(k);
 		else if (mWriter2) mWriter2->Uint64(k);
 	}
 
 	void Double(double k)
 	{
+		BeginValue();
 		if (mWriter1)
 		{
 			mWriter1->Double(k);
@@ -0,0 +1,173 @@
+/*
+** startuptrace.cpp
+** Hierarchical timing of the engine's startup phases
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <mutex>
+#include <atomic>
+#include <algorithm>
+#include "startuptrace.h"
+#include "tarray.h"
+#include "zstring.h"
+#include "files.h"
+#include "i_time.h"
+#include "dobjgc.h"
+#include "printf.h"
+
+namespace StartupTrace
+{
+
+struct FOpenScope
+{
+	const char *Name;
+	uint64_t Start;
+	size_t GCBytes;
+	uint64_t AllocatedBytes;
+};
+
+struct FEvent
+{
+	const char *Name;
+	uint64_t Start;
+	uint64_t Duration;
+	int64_t NetGCBytes;
+	uint64_t AllocatedBytes;
+	int Thread;
+	int Depth;
+};
+
+static std::atomic<bool> Enabled;
+static FString TraceFile;
+static uint64_t TraceStart;
+static std::mutex EventLock;
+static TArray<FEvent> Events;
+static std::atomic<int> NextThread;
+
+static thread_local TArray<FOpenScope> OpenScopes;
+static thread_local int ThreadID = -1;
+
+//==========================================================================
+//
+// Starts recording. Events are kept in memory until Write is called.
+//
+//==========================================================================
+
+void Enable(const char *filename)
+{
+	TraceFile = filename;
+	TraceStart = I_nsTime();
+	Enabled = true;
+}
+
+bool IsEnabled()
+{
+	return Enabled;
+}
+
+//==========================================================================
+//
+// Scopes nest per thread. Two memory figures are recorded: how much was
+// allocated during the scope, and the net change of GC::AllocBytes, which
+// goes negative if the scope freed more than it allocated. Both only
+// cover M_Malloc and friends, not new, standard containers or arenas,
+// and include whatever other threads did at the same time.
+//
+//==========================================================================
+
+void Begin(const char *name)
+{
+	if (!Enabled) return;
+	if (ThreadID < 0) ThreadID = NextThread++;
+	OpenScopes.Push({ name, I_nsTime(), GC::AllocBytes, GC::TotalAllocBytes });
+}
+
+void End()
+{
+	FOpenScope scope;
+	if (!OpenScopes.Pop(scope) || !Enabled) return;
+
+	FEvent ev;
+	ev.Name = scope.Name;
+	ev.Start = scope.Start;
+	ev.Duration = I_nsTime() - scope.Start;
+	ev.NetGCBytes = int64_t(GC::AllocBytes) - int64_t(scope.GCBytes);
+	ev.AllocatedBytes = GC::TotalAllocBytes - scope.AllocatedBytes;
+	ev.Thread = ThreadID;
+	ev.Depth = OpenScopes.Size();
+
+	std::lock_guard<std::mutex> lock(EventLock);
+	Events.Push(ev);
+}
+
+//==========================================================================
+//
+// Writes all finished scopes as complete ('X') trace events. Scopes
+// that are still open are not included. Recording stops afterward.
+//
+//==========================================================================
+
+static FString Escape(const char *str)
+{
+	FString out;
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\') out << '\\';
+		if ((unsigned char)*str < 32) continue;
+		out << *str;
+	}
+	return out;
+}
+
+void Write()
+{
+	if (!Enabled) return;
+	Enabled = false;
+
+	std::lock_guard<std::mutex> lock(EventLock);
+	auto fw = FileWriter::Open(TraceFile.GetChars());
+	if (fw == nullptr)
+	{
+		Printf(TEXTCOLOR_RED "Could not write startup trace to %s\n", TraceFile.GetChars());
+		return;
+	}
+
+	// Sort by start time and put outer scopes first so that viewers nest them properly.
+	std::sort(Events.begin(), Events.end(), [](const FEvent &a, const FEvent &b)
+	{
+		return a.Start != b.Start ? a.Start < b.Start : a.Depth < b.Depth;
+	});
+
+	fw->Printf("{\"traceEvents\":[\n");
+	for (unsigned i = 0; i < Events.Size(); i++)
+	{
+		auto &ev = Events[i];
+		fw->Printf("{\"name\":\"%s\",\"cat\":\"startup\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"allocated_bytes\":%llu,\"net_gc_bytes\":%lld}}%s\n",
+			Escape(ev.Name).GetChars(), (ev.Start - TraceStart) / 1000., ev.Duration / 1000., ev.Thread,
+			(unsigned long long)ev.AllocatedBytes, (long long)ev.NetGCBytes, i + 1 < Events.Size() ? "," : "");
+	}
+	fw->Printf("],\"displayTimeUnit\":\"ms\"}\n");
+	delete fw;
+
+	Printf("Startup trace with %u events written to %s\n", Events.Size(), TraceFile.GetChars());
+	Events.Reset();
+}
+
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+//==========================================================================
+//
+// Startup tracing
+//
+// Records nested, timed scopes (with the thread they ran on and the
+// GC-tracked memory allocated during them) and writes them out as a
+// Chrome trace-event file that can be opened in chrome://tracing or
+// Perfetto. Recording only happens after StartupTrace::Enable has been
+// called, so the scopes cost next to nothing in normal runs.
+//
+//==========================================================================
+
+namespace StartupTrace
+{
+	void Enable(const char *filename);
+	bool IsEnabled();
+	void Begin(const char *name);
+	void End();
+	void Write();
+}
+
+class FTraceScope
+{
+	bool Active;
+
+public:
+	FTraceScope(const char *name)
+	{
+		Active = StartupTrace::IsEnabled();
+		if (Active) StartupTrace::Begin(name);
+	}
+	~FTraceScope()
+	{
+		if (Active) StartupTrace::End();
+	}
+	FTraceScope(const FTraceScope &) = delete;
+	FTraceScope &operator=(const FTraceScope &) = delete;
+};
+
+#define TRACE_SCOPE_CAT2(a, b) a##b
+#define TRACE_SCOPE_CAT(a, b) TRACE_SCOPE_CAT2(a, b)
+#define TRACE_SCOPE(name) FTraceScope TRACE_SCOPE_CAT(tracescope_, __LINE__)(name)
@@ -40,6 +40,7 @@
 #include "sc_man.h"
 #include "printf.h"
 #include "i_interface.h"
+#include "startuptrace.h"
 
 //==========================================================================
 //
@@ -49,6 +50,7 @@
 
 void FStringTable::LoadStrings (const char *language)
 {
+	TRACE_SCOPE("FStringTable::LoadStrings");
 	int lastlump, lump;
 
 	lastlump = 0;
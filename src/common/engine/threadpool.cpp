@@ -0,0 +1,425 @@
+/*
+** threadpool.cpp
+** Work-stealing thread pool for the engine's parallel loops
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <thread>
+#include <condition_variable>
+#include <shared_mutex>
+#include <deque>
+#include <vector>
+#include <memory>
+#include "threadpool.h"
+#include "c_cvars.h"
+#include "stats.h"
+#include "i_time.h"
+
+// 0 uses one worker less than there are hardware threads, so that the
+// thread that submits the work has a core of its own.
+CUSTOM_CVAR(Int, i_workerthreads, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG | CVAR_NOINITCALL)
+{
+	if (self < 0) self = 0;
+	else if (self > 64) self = 64;
+	else ThreadPool::Resize(self);
+}
+
+// Upper bound for the worker count, so that the queues can be allocated once
+// and never move while some thread looks at them.
+enum { MAX_WORKERS = 64 };
+
+struct FTask
+{
+	std::function<void()> Func;
+	FTaskGroup *Group;
+};
+
+struct FTaskQueue
+{
+	std::mutex Lock;
+	std::deque<FTask> Tasks;
+};
+
+struct FThreadPool
+{
+	std::mutex StartLock;
+	std::atomic<bool> Started { false };
+	std::vector<std::thread> Workers;
+	std::unique_ptr<FTaskQueue[]> Queues;	// [0] is shared by all threads that are not workers.
+	std::atomic<int> NumQueues { 1 };
+
+	// Held shared while a task is submitted and exclusively while the pool
+	// is resized, so that nothing gets queued behind the resize's back.
+	std::shared_mutex ResizeLock;
+	std::atomic<int> Outstanding { 0 };	// tasks queued or running
+	std::atomic<int> PendingWorkers { -1 };
+
+	std::mutex SleepLock;
+	std::condition_variable WakeUp;		// workers
+	std::condition_variable GroupWake;	// threads in FTaskGroup::Wait
+	std::atomic<int> Queued { 0 };
+	bool Stopping = false;
+
+	std::atomic<uint64_t> TasksRun { 0 };
+	std::atomic<uint64_t> Steals { 0 };
+	std::atomic<uint64_t> IdleNs { 0 };
+
+	static thread_local int QueueIndex;
+
+	~FThreadPool()
+	{
+		Stop();
+	}
+
+	void Start(int workers);
+	void Stop();
+	void EnsureStarted();
+	void Push(FTask &&task);
+	bool Take(FTaskQueue &queue, FTaskGroup *group, bool newest, FTask &task);
+	bool RunOne(FTaskGroup *group = nullptr);
+	void Execute(FTask &task);
+	void WorkerMain(int index);
+};
+
+thread_local int FThreadPool::QueueIndex = 0;
+static FThreadPool Pool;
+
+//==========================================================================
+//
+// Startup and shutdown
+//
+//==========================================================================
+
+void FThreadPool::Start(int workers)
+{
+	if (workers == 0)
+	{
+		workers = std::max<int>(std::thread::hardware_concurrency(), 1) - 1;
+	}
+	workers = std::min<int>(workers, MAX_WORKERS);
+	if (Queues == nullptr) Queues.reset(new FTaskQueue[MAX_WORKERS + 1]);
+	NumQueues = workers + 1;
+	Stopping = false;
+	for (int i = 1; i <= workers; i++)
+	{
+		Workers.emplace_back([=]() { WorkerMain(i); });
+	}
+	Started = true;
+}
+
+void FThreadPool::Stop()
+{
+	{
+		std::lock_guard<std::mutex> lock(SleepLock);
+		Stopping = true;
+	}
+	WakeUp.notify_all();
+	for (auto &thread : Workers)
+	{
+		thread.join();
+	}
+	Workers.clear();
+	// Tasks nobody waits for, like the GC's background frees, must not get lost.
+	while (RunOne()) {}
+	NumQueues = 1;
+	Started = false;
+}
+
+void FThreadPool::EnsureStarted()
+{
+	if (Started) return;
+	std::lock_guard<std::mutex> lock(StartLock);
+	if (!Started) Start(i_workerthreads);
+}
+
+//==========================================================================
+//
+// Queue handling
+//
+//==========================================================================
+
+void FThreadPool::Push(FTask &&task)
+{
+	FTaskGroup *group = task.Group;
+	auto &queue = Queues[QueueIndex];
+	{
+		std::lock_guard<std::mutex> lock(queue.Lock);
+		queue.Tasks.push_back(std::move(task));
+		group->Queued++;
+		Queued++;
+	}
+	bool waiters;
+	{
+		std::lock_guard<std::mutex> lock(SleepLock);
+		waiters = group->Sleepers > 0;
+	}
+	WakeUp.notify_one();
+	if (waiters) GroupWake.notify_all();
+}
+
+// Takes the newest or oldest task from a queue, optionally only one of the
+// given group.
+bool FThreadPool::Take(FTaskQueue &queue, FTaskGroup *group, bool newest, FTask &task)
+{
+	std::lock_guard<std::mutex> lock(queue.Lock);
+	auto &tasks = queue.Tasks;
+	if (tasks.empty()) return false;
+
+	size_t index = 0;
+	if (group == nullptr)
+	{
+		index = newest ? tasks.size() - 1 : 0;
+	}
+	else
+	{
+		if (group->Queued == 0) return false;
+		size_t i;
+		for (i = 0; i < tasks.size(); i++)
+		{
+			index = newest ? tasks.size() - 1 - i : i;
+			if (tasks[index].Group == group) break;
+		}
+		if (i == tasks.size()) return false;
+	}
+	task = std::move(tasks[index]);
+	tasks.erase(tasks.begin() + index);
+	task.Group->Queued--;
+	Queued--;
+	return true;
+}
+
+bool FThreadPool::RunOne(FTaskGroup *group)
+{
+	FTask task;
+	int numqueues = NumQueues;
+
+	// Own queue first, newest task, since that is the one whose data is
+	// most likely still in the cache.
+	bool found = Take(Queues[QueueIndex], group, true, task);
+
+	// Then the oldest task of any other queue.
+	for (int i = 1; i < numqueues && !found; i++)
+	{
+		if (Take(Queues[(QueueIndex + i) % numqueues], group, false, task))
+		{
+			found = true;
+			Steals++;
+		}
+	}
+	if (!found) return false;
+
+	Execute(task);
+	return true;
+}
+
+void FThreadPool::Execute(FTask &task)
+{
+	std::exception_ptr error;
+	try
+	{
+		task.Func();
+	}
+	catch (...)
+	{
+		error = std::current_exception();
+	}
+	TasksRun++;
+	Outstanding--;
+	task.Group->Finish(error);
+}
+
+void FThreadPool::WorkerMain(int index)
+{
+	QueueIndex = index;
+	while (true)
+	{
+		if (RunOne()) continue;
+
+		uint64_t start = I_nsTime();
+		std::unique_lock<std::mutex> lock(SleepLock);
+		WakeUp.wait(lock, [this]() { return Stopping || Queued > 0; });
+		IdleNs += I_nsTime() - start;
+		if (Stopping) break;
+	}
+}
+
+//==========================================================================
+//
+// FTaskGroup
+//
+//==========================================================================
+
+FTaskGroup::~FTaskGroup()
+{
+	// Not Wait(), which may throw.
+	while (Pending > 0)
+	{
+		if (!Pool.RunOne(this)) std::this_thread::yield();
+	}
+}
+
+void FTaskGroup::Run(std::function<void()> task)
+{
+	FTask t = { std::move(task), this };
+	{
+		std::shared_lock<std::shared_mutex> lock(Pool.ResizeLock);
+		Pool.EnsureStarted();
+		Pending++;
+		Pool.Outstanding++;
+		if (Pool.NumQueues > 1)
+		{
+			Pool.Push(std::move(t));
+			return;
+		}
+	}
+	// Outside the lock, the task may queue tasks of its own.
+	Pool.Execute(t);
+}
+
+void FTaskGroup::Finish(std::exception_ptr error)
+{
+	if (error)
+	{
+		std::lock_guard<std::mutex> lock(ErrorLock);
+		if (!Error) Error = error;
+	}
+	if (--Pending == 0)
+	{
+		// Taking the lock makes sure that a waiter that is just about to
+		// sleep sees the change before it does.
+		{
+			std::lock_guard<std::mutex> lock(Pool.SleepLock);
+		}
+		Pool.GroupWake.notify_all();
+	}
+}
+
+void FTaskGroup::Wait()
+{
+	while (Pending > 0)
+	{
+		if (Pool.RunOne(this)) continue;
+
+		std::unique_lock<std::mutex> lock(Pool.SleepLock);
+		Sleepers++;
+		Pool.GroupWake.wait(lock, [this]() { return Pending == 0 || Queued > 0; });
+		Sleepers--;
+	}
+
+	std::exception_ptr error;
+	{
+		std::lock_guard<std::mutex> lock(ErrorLock);
+		std::swap(error, Error);
+	}
+	if (error) std::rethrow_exception(error);
+}
+
+//==========================================================================
+//
+// ThreadPool
+//
+//==========================================================================
+
+namespace ThreadPool
+{
+
+int NumWorkers()
+{
+	Pool.EnsureStarted();
+	return Pool.NumQueues - 1;
+}
+
+void Resize(int workers)
+{
+	// Other threads may have tasks in flight right now, e.g. the GC's
+	// background frees or a node cache job, so this only takes note.
+	Pool.PendingWorkers = workers;
+}
+
+void ApplyResize()
+{
+	if (Pool.PendingWorkers < 0 || FThreadPool::QueueIndex != 0) return;
+
+	std::unique_lock<std::shared_mutex> lock(Pool.ResizeLock);
+	if (Pool.Outstanding > 0) return;	// try again next frame.
+
+	std::lock_guard<std::mutex> startlock(Pool.StartLock);
+	int workers = Pool.PendingWorkers.exchange(-1);
+	if (workers < 0 || !Pool.Started) return;	// picks up the CVAR when it is first used.
+	Pool.Stop();
+	Pool.Start(workers);
+}
+
+// The calling thread keeps the lower half of the range and queues the
+// upper half until the rest is small enough. Thieves take the oldest,
+// i.e. largest, pieces and split them further in turn.
+static void SplitRange(FTaskGroup &group, int begin, int end, int grain, const std::function<void(int, int)> &body)
+{
+	while (end - begin > grain)
+	{
+		int mid = begin + (end - begin) / 2;
+		group.Run([=, &group, &body]() { SplitRange(group, mid, end, grain, body); });
+		end = mid;
+	}
+	body(begin, end);
+}
+
+void ParallelFor(int count, int grain, const std::function<void(int, int)> &body)
+{
+	if (count <= 0) return;
+
+	int workers = NumWorkers();
+	if (grain <= 0)
+	{
+		// Several pieces per thread so that uneven work still balances out.
+		grain = std::max(1, count / ((workers + 1) * 8));
+	}
+	if (workers == 0 || count <= grain)
+	{
+		body(0, count);
+		return;
+	}
+
+	FTaskGroup group;
+	SplitRange(group, 0, count, grain, body);
+	group.Wait();
+}
+
+FThreadPoolStats GetStats()
+{
+	return { Pool.Started ? Pool.NumQueues - 1 : 0, Pool.TasksRun, Pool.Steals, Pool.IdleNs };
+}
+
+}
+
+//==========================================================================
+//
+// STAT threadpool
+//
+//==========================================================================
+
+ADD_STAT(threadpool)
+{
+	auto stats = ThreadPool::GetStats();
+	FString out;
+	out.Format("Workers: %d  Tasks run: %llu  Steals: %llu  Idle: %.2f s",
+		stats.Workers, (unsigned long long)stats.TasksRun, (unsigned long long)stats.Steals, stats.IdleNs / 1e9);
+	return out;
+}
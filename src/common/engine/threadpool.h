@@ -0,0 +1,82 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <mutex>
+
+//==========================================================================
+//
+// Engine thread pool
+//
+// A fixed set of worker threads, sized by i_workerthreads. Every worker
+// has its own task queue; it runs the newest task from its own queue first
+// and, when that is empty, steals the oldest task from another queue.
+// Threads that are not workers share one queue. Parallel loops split their
+// range in halves, so the oldest tasks are the largest chunks, and that is
+// what gets stolen.
+//
+// A thread waiting for a task group keeps running that group's queued tasks
+// until it is done. It never picks up other groups' work, so the game thread
+// cannot get stuck in a chunk of some background job. Nested parallel loops,
+// e.g. an upscaler running inside a parallel precache batch, cannot deadlock
+// the pool either: every waiter can make progress on its own group.
+//
+//==========================================================================
+
+class FTaskGroup
+{
+public:
+	FTaskGroup() = default;
+	~FTaskGroup();
+	FTaskGroup(const FTaskGroup &) = delete;
+	FTaskGroup &operator=(const FTaskGroup &) = delete;
+
+	// Queues a task. Without worker threads it is run right away.
+	void Run(std::function<void()> task);
+
+	// Returns once all tasks of this group have finished. Rethrows the
+	// first exception thrown by any of them.
+	void Wait();
+
+private:
+	friend struct FThreadPool;
+
+	void Finish(std::exception_ptr error);
+
+	std::atomic<int> Pending { 0 };
+	std::atomic<int> Queued { 0 };		// tasks still sitting in a queue
+	int Sleepers = 0;					// waiters blocked in Wait, guarded by the pool's SleepLock
+	std::mutex ErrorLock;
+	std::exception_ptr Error;
+};
+
+struct FThreadPoolStats
+{
+	int Workers;
+	uint64_t TasksRun;
+	uint64_t Steals;
+	uint64_t IdleNs;
+};
+
+namespace ThreadPool
+{
+	// Number of worker threads, not counting the threads that submit work.
+	int NumWorkers();
+
+	// Requests a different number of workers. Takes effect with the next
+	// ApplyResize that finds no tasks in flight.
+	void Resize(int workers);
+
+	// Restarts the pool if a resize is pending and no task is queued or
+	// running. Called by the main loop once per frame; does nothing when
+	// called from a worker, which cannot stop itself.
+	void ApplyResize();
+
+	// Calls body(begin, end) for consecutive sub-ranges of [0, count) that
+	// are no longer than grain (0 picks a size from the worker count).
+	void ParallelFor(int count, int grain, const std::function<void(int, int)> &body);
+
+	FThreadPoolStats GetStats();
+}
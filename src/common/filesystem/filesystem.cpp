@@ -46,6 +46,7 @@
 #include "m_crc32.h"
 #include "printf.h"
 #include "md5.h"
+#include "startuptrace.h"
 
 extern	FILE* hashfile;
 
@@ -197,6 +198,7 @@ void FileSystem::InitSingleFile(const char* filename, bool quiet)
 
 void FileSystem::InitMultipleFiles (TArray<FString> &filenames, bool quiet, LumpFilterInfo* filter)
 {
+	TRACE_SCOPE("FileSystem::InitMultipleFiles");
 	int numfiles;
 
 	// open all the files, load headers, and count lumps
@@ -1353,6 +1355,24 @@ FileData FileSystem::ReadFile (int lump)
 	return FileData(FString(ELumpNum(lump)));
 }
 
+//==========================================================================
+//
+// GetRawData
+//
+// Reads the lump's data without decompressing it. The buffer must be
+// freed with FCompressedBuffer::Clean.
+//
+//==========================================================================
+
+FCompressedBuffer FileSystem::GetRawData(int lump)
+{
+	if ((unsigned)lump >= (unsigned)FileInfo.Size())
+	{
+		I_Error("GetRawData: %u >= NumEntries", lump);
+	}
+	return FileInfo[lump].lump->GetRawData();
+}
+
 //==========================================================================
 //
 // OpenFileReader
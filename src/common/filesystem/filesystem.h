@@ -132,6 +132,7 @@ public:
 	TArray<uint8_t> GetFileData(int lump, int pad = 0);	// reads lump into a writable buffer and optionally adds some padding at the end. (FileData isn't writable!)
 	FileData ReadFile (int lump);
 	FileData ReadFile (const char *name) { return ReadFile (GetNumForName (name)); }
+	FCompressedBuffer GetRawData(int lump);	// reads the lump's data as stored in the container, i.e. still compressed.
 
 	inline TArray<uint8_t> LoadFile(const char* name, int padding = 0)
 	{
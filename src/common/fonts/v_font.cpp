@@ -55,6 +55,7 @@
 #include "palentry.h"
 
 #include "fontinternals.h"
+#include "startuptrace.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -861,6 +862,7 @@ EColorRange V_ParseFontColor (const uint8_t *&color_value, int normalcolor, int
 
 void V_InitFonts()
 {
+	TRACE_SCOPE("V_InitFonts");
 	CreateLuminosityTranslationRanges();
 	V_InitCustomFonts();
 
@@ -877,6 +879,7 @@ void V_InitFonts()
 
 void V_LoadTranslations()
 {
+	V_ClearGlyphRuns();
 	for (auto font = FFont::FirstFont; font; font = font->Next)
 	{
 		if (!font->noTranslate) font->LoadTranslations();
@@ -920,6 +923,7 @@ void V_LoadTranslations()
 
 void V_ClearFonts()
 {
+	V_ClearGlyphRuns();
 	while (FFont::FirstFont != nullptr)
 	{
 		delete FFont::FirstFont;
@@ -213,6 +213,7 @@ extern FFont *SmallFont, *SmallFont2, *BigFont, *BigUpper, *ConFont, *Intermissi
 
 void V_InitFonts();
 void V_ClearFonts();
+void V_ClearGlyphRuns();
 EColorRange V_FindFontColor (FName name);
 PalEntry V_LogColorFromColorRange (EColorRange range);
 EColorRange V_ParseFontColor (const uint8_t *&color_value, int normalcolor, int boldcolor);
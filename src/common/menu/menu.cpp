@@ -54,6 +54,7 @@
 #include "menustate.h"
 #include "i_time.h"
 #include "printf.h"
+#include "startuptrace.h"
 
 void M_StartControlPanel(bool makeSound, bool scaleoverride = false);
 
@@ -922,6 +923,7 @@ void M_PreviousMenu()
 
 void M_Init (void) 
 {
+	TRACE_SCOPE("M_Init");
 	try
 	{
 		M_ParseMenuDefs();
@@ -37,6 +37,7 @@
 #include <stdlib.h>
 #include <type_traits>
 #include "m_alloc.h"
+#include "dobjpool.h"
 #include "vectors.h"
 #include "name.h"
 #include "palentry.h"
@@ -267,18 +268,20 @@ private:
 
 	void *operator new(size_t len, nonew&)
 	{
-		return M_Calloc(len, 1);
+		auto mem = ObjectPool::Alloc(len);
+		memset(mem, 0, len);
+		return mem;
 	}
 public:
 
 	void operator delete (void *mem, nonew&)
 	{
-		M_Free(mem);
+		GC::FreeObjectMemory(mem);
 	}
 
 	void operator delete (void *mem)
 	{
-		M_Free(mem);
+		GC::FreeObjectMemory(mem);
 	}
 
 	// GC fiddling
@@ -345,7 +348,7 @@ protected:
 
 	void operator delete (void *mem, EInPlace *)
 	{
-		M_Free (mem);
+		GC::FreeObjectMemory(mem);
 	}
 
 	template<typename T, typename... Args>
@@ -62,6 +62,9 @@
 #include "menu.h"
 #include "stats.h"
 #include "printf.h"
+#include "c_cvars.h"
+#include "i_time.h"
+#include "threadpool.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -91,8 +94,26 @@
 #define GCSWEEPCOST		10
 #define GCFINALIZECOST	100
 
+// Number of swept objects whose memory is handed to a worker at once.
+
+#define GCFREEBATCH		256
+
 // TYPES -------------------------------------------------------------------
 
+// Pause time histogram buckets, upper bounds in microseconds. The last
+// bucket takes everything longer.
+
+enum { NUM_PAUSEBUCKETS = 8 };
+static const int PauseBuckets[NUM_PAUSEBUCKETS - 1] = { 50, 100, 250, 500, 1000, 2000, 5000 };
+
+struct FPauseHistogram
+{
+	unsigned Counts[NUM_PAUSEBUCKETS];
+	uint64_t Max;
+	uint64_t Total;
+	unsigned Num;
+};
+
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 
 // PUBLIC FUNCTION PROTOTYPES ----------------------------------------------
@@ -103,9 +124,12 @@
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
+CVAR(Bool, gc_backgroundfree, true, 0)
+
 namespace GC
 {
-size_t AllocBytes;
+std::atomic<size_t> AllocBytes;
+std::atomic<uint64_t> TotalAllocBytes;
 size_t Threshold;
 size_t Estimate;
 DObject *Gray;
@@ -122,6 +146,16 @@ bool FinalGC;
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
+// Swept objects are destroyed on the game thread, since their destructors
+// may touch anything. Only releasing their memory is left to the thread
+// pool, which is safe because nothing can reference them anymore.
+static bool Sweeping;
+static TArray<void *> PendingFrees;
+static FTaskGroup *FreeTasks;	// never deleted, the pool may be gone before static destruction.
+static size_t BackgroundFrees;
+
+static FPauseHistogram StepPauses, FullPauses;
+
 // CODE --------------------------------------------------------------------
 
 //==========================================================================
@@ -137,6 +171,71 @@ void SetThreshold()
 	Threshold = (Estimate / 100) * Pause;
 }
 
+//==========================================================================
+//
+// FreeObjectMemory
+//
+// Called by DObject's operator delete. Pooled memory is reused right away.
+// For other objects, the sweep only collects the memory here, it gets
+// handed to the thread pool in batches.
+//
+//==========================================================================
+
+static void FlushFrees(bool wait)
+{
+	if (PendingFrees.Size() > 0)
+	{
+		if (FreeTasks == nullptr) FreeTasks = new FTaskGroup;
+		TArray<void *> batch;
+		batch.Swap(PendingFrees);
+		BackgroundFrees += batch.Size();
+		FreeTasks->Run([batch]()
+		{
+			for (auto mem : batch) M_FreeUntracked(mem);
+		});
+	}
+	if (wait && FreeTasks != nullptr)
+	{
+		FreeTasks->Wait();
+	}
+}
+
+void FreeObjectMemory(void *mem)
+{
+	mem = ObjectPool::Free(mem);
+	if (mem == nullptr)
+	{
+		return;
+	}
+	if (!Sweeping)
+	{
+		M_Free(mem);
+		return;
+	}
+	M_Untrack(mem);
+	PendingFrees.Push(mem);
+	if (PendingFrees.Size() >= GCFREEBATCH)
+	{
+		FlushFrees(false);
+	}
+}
+
+//==========================================================================
+//
+// AddPause
+//
+//==========================================================================
+
+static void AddPause(FPauseHistogram &hist, uint64_t ns)
+{
+	int i = 0;
+	while (i < NUM_PAUSEBUCKETS - 1 && ns > uint64_t(PauseBuckets[i]) * 1000) i++;
+	hist.Counts[i]++;
+	hist.Max = MAX(hist.Max, ns);
+	hist.Total += ns;
+	hist.Num++;
+}
+
 //==========================================================================
 //
 // PropagateMark
@@ -341,17 +440,21 @@ static size_t SingleStep()
 	case GCS_Sweep: {
 		size_t old = AllocBytes;
 		size_t finalize_count;
+		Sweeping = gc_backgroundfree && !FinalGC;
 		SweepPos = SweepList(SweepPos, GCSWEEPMAX, &finalize_count);
+		Sweeping = false;
 		if (*SweepPos == NULL)
 		{ // Nothing more to sweep?
 			State = GCS_Finalize;
 		}
-		//assert(old >= AllocBytes);
-		Estimate -= MAX<size_t>(0, old - AllocBytes);
+		// Other threads may have allocated in the meantime.
+		size_t now = AllocBytes;
+		if (old > now) Estimate -= old - now;
 		return (GCSWEEPMAX - finalize_count) * GCSWEEPCOST + finalize_count * GCFINALIZECOST;
 	  }
 
 	case GCS_Finalize:
+		FlushFrees(false);
 		State = GCS_Pause;		// end collection
 		Dept = 0;
 		return 0;
@@ -373,6 +476,7 @@ static size_t SingleStep()
 
 void Step()
 {
+	uint64_t start = I_nsTime();
 	size_t lim = (GCSTEPSIZE/100) * StepMul;
 	size_t olim;
 	if (lim == 0)
@@ -403,6 +507,8 @@ void Step()
 		SetThreshold();
 	}
 	StepCount++;
+	FlushFrees(false);
+	AddPause(StepPauses, I_nsTime() - start);
 }
 
 //==========================================================================
@@ -415,6 +521,7 @@ void Step()
 
 void FullGC()
 {
+	uint64_t start = I_nsTime();
 	if (State <= GCS_Propagate)
 	{
 		// Reset sweep mark to sweep all elements (returning them to white)
@@ -434,6 +541,9 @@ void FullGC()
 		SingleStep();
 	}
 	SetThreshold();
+	// Nothing may be pending when the engine shuts down.
+	FlushFrees(FinalGC);
+	AddPause(FullPauses, I_nsTime() - start);
 }
 
 //==========================================================================
@@ -580,6 +690,20 @@ ADD_STAT(gc)
 	{
 		out.AppendFormat("  %zuK", (GC::Dept + 1023) >> 10);
 	}
+	out.AppendFormat("  Background frees: %zu", GC::BackgroundFrees);
+
+	auto hist = [&](const char *name, const FPauseHistogram &h)
+	{
+		out.AppendFormat("\n%s pauses: %u  avg %.3f ms  max %.3f ms  |", name, h.Num,
+			h.Num == 0 ? 0. : h.Total / 1e6 / h.Num, h.Max / 1e6);
+		for (int i = 0; i < NUM_PAUSEBUCKETS - 1; i++)
+		{
+			out.AppendFormat("  <%gms: %u", PauseBuckets[i] / 1000., h.Counts[i]);
+		}
+		out.AppendFormat("  more: %u", h.Counts[NUM_PAUSEBUCKETS - 1]);
+	};
+	hist("Step", GC::StepPauses);
+	hist("Full", GC::FullPauses);
 	return out;
 }
 
@@ -595,7 +719,7 @@ CCMD(gc)
 {
 	if (argv.argc() == 1)
 	{
-		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]\n");
+		Printf ("Usage: gc stop|now|full|count|pause [size]|stepmul [size]|resetpauses\n");
 		return;
 	}
 	if (stricmp(argv[1], "stop") == 0)
@@ -627,6 +751,11 @@ CCMD(gc)
 			GC::Pause = MAX(1,atoi(argv[2]));
 		}
 	}
+	else if (stricmp(argv[1], "resetpauses") == 0)
+	{
+		GC::StepPauses = {};
+		GC::FullPauses = {};
+	}
 	else if (stricmp(argv[1], "stepmul") == 0)
 	{
 		if (argv.argc() == 2)
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdint.h>
+#include <atomic>
 #include "tarray.h"
 class DObject;
 class FSerializer;
@@ -41,7 +42,12 @@ namespace GC
 	};
 
 	// Number of bytes currently allocated through M_Malloc/M_Realloc.
-	extern size_t AllocBytes;
+	// Atomic because worker threads allocate and free through those, too.
+	extern std::atomic<size_t> AllocBytes;
+
+	// Sum of the sizes of all blocks ever handed out by M_Malloc/M_Realloc.
+	// Unlike AllocBytes this never goes down.
+	extern std::atomic<uint64_t> TotalAllocBytes;
 
 	// Amount of memory to allocate before triggering a collection.
 	extern size_t Threshold;
@@ -85,6 +91,10 @@ namespace GC
 	// Does a complete collection.
 	void FullGC();
 
+	// Releases the memory of a deleted object. Pooled memory is reused,
+	// other objects deleted by the sweep are released on a worker thread.
+	void FreeObjectMemory(void *mem);
+
 	// Handles the grunt work for a write barrier.
 	void Barrier(DObject *pointing, DObject *pointed);
 
@@ -0,0 +1,200 @@
+/*
+** dobjpool.cpp
+** Size class slab pools for DObject instances
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <stdint.h>
+#include "dobjpool.h"
+#include "dobject.h"
+#include "engineerrors.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "printf.h"
+
+CVAR(Bool, gc_objectpools, true, 0)
+
+namespace ObjectPool
+{
+
+enum
+{
+	Granularity = 32,
+	MaxBlockSize = 4096 + Granularity,	// AActor and most of its script subclasses fit.
+	NumSizeClasses = MaxBlockSize / Granularity,
+	MinSlabSize = 65536,
+	MinSlabBlocks = 16,
+	Unpooled = 0xffffffff,
+};
+
+// Precedes every object. Keeps the objects 16 byte aligned.
+struct alignas(16) FPoolHeader
+{
+	uint32_t SizeClass;
+};
+
+struct FPoolBlock
+{
+	FPoolBlock *Next;
+};
+
+struct FSizeClass
+{
+	FPoolBlock *FreeList;
+	uint8_t *Bump, *BumpEnd;	// unused rest of the newest slab
+	unsigned Slabs;
+	unsigned InUse;
+	unsigned Free;
+	uint64_t Allocs;
+	uint64_t Reused;
+};
+
+static FSizeClass Classes[NumSizeClasses];
+static unsigned UnpooledInUse;
+static uint64_t UnpooledAllocs;
+
+static inline size_t BlockSize(unsigned sizeclass)
+{
+	return (sizeclass + 1) * Granularity;
+}
+
+static inline size_t SlabSize(unsigned sizeclass)
+{
+	size_t blocksize = BlockSize(sizeclass);
+	size_t slabsize = blocksize * MinSlabBlocks;
+	return slabsize >= MinSlabSize ? slabsize : MinSlabSize - MinSlabSize % blocksize;
+}
+
+//==========================================================================
+//
+// Slabs come straight from the heap. The allocation counter of the GC
+// only counts the blocks that are in use, so that the collector's pacing
+// is the same as with individual allocations.
+//
+//==========================================================================
+
+static FPoolHeader *NewBlock(unsigned index)
+{
+	auto &sc = Classes[index];
+	size_t blocksize = BlockSize(index);
+
+	if (sc.Bump == sc.BumpEnd)
+	{
+		size_t slabsize = SlabSize(index);
+		sc.Bump = (uint8_t *)malloc(slabsize);
+		if (sc.Bump == nullptr)
+		{
+			I_FatalError("Could not malloc %zu bytes", slabsize);
+		}
+		sc.BumpEnd = sc.Bump + slabsize;
+		sc.Slabs++;
+	}
+	auto header = (FPoolHeader *)sc.Bump;
+	sc.Bump += blocksize;
+	return header;
+}
+
+void *Alloc(size_t size)
+{
+	size_t total = size + sizeof(FPoolHeader);
+	FPoolHeader *header;
+
+	if (!gc_objectpools || total > MaxBlockSize)
+	{
+		header = (FPoolHeader *)M_Malloc(total);
+		header->SizeClass = Unpooled;
+		UnpooledInUse++;
+		UnpooledAllocs++;
+		return header + 1;
+	}
+
+	unsigned index = unsigned((total - 1) / Granularity);
+	auto &sc = Classes[index];
+	if (sc.FreeList != nullptr)
+	{
+		// Most recently freed first, that one is most likely still cached.
+		header = (FPoolHeader *)sc.FreeList;
+		sc.FreeList = sc.FreeList->Next;
+		sc.Free--;
+		sc.Reused++;
+	}
+	else
+	{
+		header = NewBlock(index);
+	}
+	header->SizeClass = index;
+	sc.InUse++;
+	sc.Allocs++;
+	GC::AllocBytes += BlockSize(index);
+	return header + 1;
+}
+
+void *Free(void *mem)
+{
+	if (mem == nullptr) return nullptr;
+
+	auto header = (FPoolHeader *)mem - 1;
+	unsigned index = header->SizeClass;
+	if (index == Unpooled)
+	{
+		UnpooledInUse--;
+		return header;
+	}
+
+	assert(index < NumSizeClasses);
+	auto &sc = Classes[index];
+	auto block = (FPoolBlock *)header;
+	block->Next = sc.FreeList;
+	sc.FreeList = block;
+	sc.InUse--;
+	sc.Free++;
+	GC::AllocBytes -= BlockSize(index);
+	return nullptr;
+}
+
+}
+
+//==========================================================================
+//
+// CCMD dumpobjpools
+//
+//==========================================================================
+
+CCMD(dumpobjpools)
+{
+	using namespace ObjectPool;
+
+	size_t totalused = 0, totalslabs = 0;
+	Printf("%6s %6s %8s %8s %10s %6s\n", "Size", "Slabs", "In use", "Free", "Allocs", "Reuse");
+	for (unsigned i = 0; i < NumSizeClasses; i++)
+	{
+		auto &sc = Classes[i];
+		if (sc.Slabs == 0) continue;
+
+		size_t blocksize = BlockSize(i);
+		totalused += sc.InUse * blocksize;
+		totalslabs += sc.Slabs * SlabSize(i);
+
+		Printf("%6zu %6u %8u %8u %10llu %5.1f%%\n", blocksize, sc.Slabs, sc.InUse, sc.Free,
+			(unsigned long long)sc.Allocs, sc.Allocs == 0 ? 0. : sc.Reused * 100. / sc.Allocs);
+	}
+	Printf("Pooled: %zuK in use of %zuK in slabs\n", (totalused + 1023) >> 10, (totalslabs + 1023) >> 10);
+	Printf("Unpooled: %u in use, %llu allocations\n", UnpooledInUse, (unsigned long long)UnpooledAllocs);
+}
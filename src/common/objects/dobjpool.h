@@ -0,0 +1,29 @@
+#pragma once
+
+#include <stddef.h>
+
+//==========================================================================
+//
+// Object pools
+//
+// DObjects are allocated from slabs, one set per size class, instead of
+// one heap block each. Freed objects go on their class's free list and
+// are reused by the next spawn of the same size, so projectile churn does
+// not fragment the heap and actors of the same class end up close to each
+// other. Objects too large for the pools get a block of their own.
+//
+// Slabs are never returned to the heap; a pool keeps the size it had at
+// its peak.
+//
+//==========================================================================
+
+namespace ObjectPool
+{
+	// Returns uninitialized memory for an object of this size.
+	void *Alloc(size_t size);
+
+	// Puts a pooled object's memory back on its free list and returns
+	// nullptr. For an object that was not pooled, the heap block is
+	// returned instead, which the caller has to pass to M_Free.
+	void *Free(void *mem);
+}
@@ -73,6 +73,7 @@ public:
 	{
 		return glTexID;
 	}
+	bool IsCreated() const override { return glTexID != 0; }
 
 	int numChannels() { return glTextureBytes; }
 };
@@ -34,6 +34,7 @@ public:
 	void AllocateBuffer(int w, int h, int texelsize) override;
 	uint8_t *MapBuffer() override;
 	unsigned int CreateTexture(unsigned char * buffer, int w, int h, int texunit, bool mipmap, const char *name) override;
+	bool IsCreated() const override { return mImage.Image != nullptr; }
 
 	// Wipe screen
 	void CreateWipeTexture(int w, int h, const char *name);
@@ -7191,6 +7191,8 @@ FxExpression *FxArrayElement::Resolve(FCompileContext &ctx)
 		{
 			auto parentfield = static_cast<FxMemberBase *>(Array)->membervar;
 			SizeAddr = parentfield->Offset + sizeof(void*);
+			bool ismeta = Array->ExprType == EFX_ClassMember && parentfield->Flags & VARF_Meta;
+			SizeField = Create<PField>(NAME_None, TypeUInt32, ismeta? VARF_Meta : 0, SizeAddr);
 		}
 		else if (Array->ExprType == EFX_ArrayElement || Array->ExprType == EFX_OutVarDereference)
 		{
@@ -7272,12 +7274,10 @@ ExpEmit FxArrayElement::Emit(VMFunctionBuilder *build)
 	
 	if (SizeAddr != ~0u)
 	{
-		bool ismeta = Array->ExprType == EFX_ClassMember && static_cast<FxClassMember*>(Array)->membervar->Flags & VARF_Meta;
-
 		start = ExpEmit(build, REGT_POINTER);
 		build->Emit(OP_LP, start.RegNum, arrayvar.RegNum, build->GetConstantInt(0));
 
-		auto f = Create<PField>(NAME_None, TypeUInt32, ismeta? VARF_Meta : 0, SizeAddr);
+		auto f = SizeField;
 		auto arraymemberbase = static_cast<FxMemberBase *>(Array);
 
 		auto origmembervar = arraymemberbase->membervar;
@@ -135,10 +135,13 @@ struct ExpVal
 		}
 	}
 
+	// String values always get their own buffer, so that copying them while
+	// emitting code on a worker thread never touches another function's
+	// reference counts.
 	ExpVal(const FString &str)
 	{
 		Type = TypeString;
-		::new(&pointer) FString(str);
+		::new(&pointer) FString(str.GetChars(), str.Len());
 	}
 
 	ExpVal(const ExpVal &o)
@@ -146,7 +149,8 @@ struct ExpVal
 		Type = o.Type;
 		if (o.Type == TypeString)
 		{
-			::new(&pointer) FString(*(FString *)&o.pointer);
+			auto &str = *(FString *)&o.pointer;
+			::new(&pointer) FString(str.GetChars(), str.Len());
 		}
 		else
 		{
@@ -163,7 +167,8 @@ struct ExpVal
 		Type = o.Type;
 		if (o.Type == TypeString)
 		{
-			::new(&pointer) FString(*(FString *)&o.pointer);
+			auto &str = *(FString *)&o.pointer;
+			::new(&pointer) FString(str.GetChars(), str.Len());
 		}
 		else
 		{
@@ -1502,6 +1507,7 @@ public:
 	FxExpression *Array;
 	FxExpression *index;
 	size_t SizeAddr;
+	PField *SizeField = nullptr;	// created by Resolve because Emit may run on a worker thread.
 	bool AddressRequested;
 	bool AddressWritable;
 	bool arrayispointer = false;
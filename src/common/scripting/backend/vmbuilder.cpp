@@ -37,8 +37,11 @@
 #include "m_argv.h"
 #include "c_cvars.h"
 #include "jit.h"
+#include "parallel_for.h"
+#include "startuptrace.h"
 
 CVAR(Bool, strictdecorate, false, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
+CVAR(Bool, vm_multithreadcompile, true, CVAR_GLOBALCONFIG | CVAR_ARCHIVE)
 
 struct VMRemap
 {
@@ -117,6 +120,13 @@ void VMFunctionBuilder::MakeFunction(VMScriptFunction *func)
 	memcpy(func->Code, &Code[0], Code.Size() * sizeof(VMOP));
 	memcpy(func->LineInfo, &LineNumbers[0], LineNumbers.Size() * sizeof(LineNumbers[0]));
 
+	for (auto &konst : ArenaConstants)
+	{
+		void *copy = ClassDataAllocator.Alloc(konst.Data.size());
+		memcpy(copy, konst.Data.data(), konst.Data.size());
+		AddressConstantList[konst.Loc] = copy;
+	}
+
 	// Create constant tables.
 	if (IntConstantList.Size() > 0)
 	{
@@ -289,6 +299,24 @@ unsigned VMFunctionBuilder::GetConstantAddress(void *ptr)
 	}
 }
 
+//==========================================================================
+//
+// VMFunctionBuilder :: GetConstantArenaCopy
+//
+// The code generator may run on a worker thread, so the data is kept in
+// the builder until MakeFunction puts it in the arena. The register is
+// never shared since the final address is not known yet.
+//
+//==========================================================================
+
+unsigned VMFunctionBuilder::GetConstantArenaCopy(const void *data, unsigned size)
+{
+	unsigned loc = AddressConstantList.Push(nullptr);
+	auto bytes = (const uint8_t *)data;
+	ArenaConstants.push_back({ loc, std::vector<uint8_t>(bytes, bytes + size) });
+	return loc;
+}
+
 //==========================================================================
 //
 // VMFunctionBuilder :: AllocConstants*
@@ -814,10 +842,15 @@ VMFunction *FFunctionBuildList::AddFunction(PNamespace *gnspc, const VersionInfo
 
 void FFunctionBuildList::Build()
 {
+	TRACE_SCOPE("FFunctionBuildList::Build");
 	VMDisassemblyDumper disasmdump(VMDisassemblyDumper::Overwrite);
+	TArray<unsigned> emitlist;
 
-	for (auto &item : mItems)
+	// Resolving can create new types and symbols, so it has to be done one function at a time.
+	for (unsigned ndx = 0; ndx < mItems.Size(); ndx++)
 	{
+		auto &item = mItems[ndx];
+
 		// [Player701] Do not emit code for abstract functions
 		bool isAbstract = item.Func->Variants[0].Implementation->VarFlags & VARF_Abstract;
 		if (isAbstract) continue;
@@ -825,10 +858,13 @@ void FFunctionBuildList::Build()
 		assert(item.Code != NULL);
 
 		// We don't know the return type in advance for anonymous functions.
-		FCompileContext ctx(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
+		// The context owns the argument declarations so it must live until the code has been emitted.
+		item.Context = new FCompileContext(item.CurGlobals, item.Func, item.Func->SymbolName == NAME_None ? nullptr : item.Func->Variants[0].Proto, item.FromDecorate, item.StateIndex, item.StateCount, item.Lump, item.Version);
+		FCompileContext &ctx = *item.Context;
 
 		// Allocate registers for the function's arguments and create local variable nodes before starting to resolve it.
-		VMFunctionBuilder buildit(item.Func->GetImplicitArgs());
+		item.Builder = new VMFunctionBuilder(item.Func->GetImplicitArgs());
+		VMFunctionBuilder &buildit = *item.Builder;
 		for (unsigned i = 0; i < item.Func->Variants[0].Proto->ArgumentTypes.Size(); i++)
 		{
 			auto type = item.Func->Variants[0].Proto->ArgumentTypes[i];
@@ -877,45 +913,69 @@ void FFunctionBuildList::Build()
 				sfunc->Proto = NewPrototype(item.Proto->ReturnTypes, item.Func->Variants[0].Proto->ArgumentTypes);
 				sfunc->ArgFlags = item.Func->Variants[0].ArgFlags;
 			}
+			sfunc->SourceFileName = item.Code->ScriptPosition.FileName.GetChars();	// remember the file name for printing error messages if something goes wrong in the VM.
+			emitlist.Push(ndx);
+		}
+	}
+
+	// Emitting a function's code only touches its own expression tree and builder,
+	// so this can be spread over several threads. Errors are reported afterward
+	// in the same order as before.
+	if (vm_multithreadcompile)
+	{
+		parallel_for((int)emitlist.Size(), [&](int i)
+		{
+			EmitCode(mItems[emitlist[i]]);
+		});
+	}
+	else
+	{
+		for (auto ndx : emitlist) EmitCode(mItems[ndx]);
+	}
+
+	for (auto &item : mItems)
+	{
+		if (item.Context == nullptr) continue;
+
+		FScriptPosition::StrictErrors = !item.FromDecorate || strictdecorate;
+		for (auto &msg : item.Messages)
+		{
+			msg.Pos.Report(msg.Severity, msg.Text);
+		}
 
-			// Emit code
-			try
+		if (item.Emitted)
+		{
+			VMScriptFunction *sfunc = item.Function;
+			item.Builder->MakeFunction(sfunc);
+			sfunc->NumArgs = 0;
+			// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
+			// For the VM a vector is 2 or 3 args, depending on size.
+			auto funcVariant = item.Func->Variants[0];
+			for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
 			{
-				sfunc->SourceFileName = item.Code->ScriptPosition.FileName.GetChars();	// remember the file name for printing error messages if something goes wrong in the VM.
-				buildit.BeginStatement(item.Code);
-				item.Code->Emit(&buildit);
-				buildit.EndStatement();
-				buildit.MakeFunction(sfunc);
-				sfunc->NumArgs = 0;
-				// NumArgs for the VMFunction must be the amount of stack elements, which can differ from the amount of logical function arguments if vectors are in the list.
-				// For the VM a vector is 2 or 3 args, depending on size.
-				auto funcVariant = item.Func->Variants[0];
-				for (unsigned int i = 0; i < funcVariant.Proto->ArgumentTypes.Size(); i++)
+				auto argType = funcVariant.Proto->ArgumentTypes[i];
+				auto argFlags = funcVariant.ArgFlags[i];
+				if (argFlags & VARF_Out)
 				{
-					auto argType = funcVariant.Proto->ArgumentTypes[i];
-					auto argFlags = funcVariant.ArgFlags[i];
-					if (argFlags & VARF_Out)
-					{
-						auto argPointer = NewPointer(argType);
-						sfunc->NumArgs += argPointer->GetRegCount();
-					}
-					else
-					{
-						sfunc->NumArgs += argType->GetRegCount();
-					}
+					auto argPointer = NewPointer(argType);
+					sfunc->NumArgs += argPointer->GetRegCount();
+				}
+				else
+				{
+					sfunc->NumArgs += argType->GetRegCount();
 				}
+			}
 
-				disasmdump.Write(sfunc, item.PrintableName);
+			disasmdump.Write(sfunc, item.PrintableName);
 
-				sfunc->Unsafe = ctx.Unsafe;
-			}
-			catch (CRecoverableError &err)
-			{
-				// catch errors from the code generator and pring something meaningful.
-				item.Code->ScriptPosition.Message(MSG_ERROR, "%s in %s", err.GetMessage(), item.PrintableName.GetChars());
-			}
+			sfunc->Unsafe = item.Context->Unsafe;
 		}
 		delete item.Code;
+		delete item.Builder;
+		delete item.Context;
+		item.Code = nullptr;
+		item.Builder = nullptr;
+		item.Context = nullptr;
 		disasmdump.Flush();
 	}
 	VMFunction::CreateRegUseInfo();
@@ -927,6 +987,34 @@ void FFunctionBuildList::Build()
 	FxAlloc.FreeAllBlocks();
 }
 
+//==========================================================================
+//
+// Emits the code of one resolved function into its builder. This may run
+// on a worker thread so it must not report anything directly or touch
+// anything outside the item.
+//
+//==========================================================================
+
+void FFunctionBuildList::EmitCode(Item &item)
+{
+	VMFunctionBuilder &buildit = *item.Builder;
+
+	FScriptPosition::Deferred = &item.Messages;
+	try
+	{
+		buildit.BeginStatement(item.Code);
+		item.Code->Emit(&buildit);
+		buildit.EndStatement();
+		item.Emitted = true;
+	}
+	catch (CRecoverableError &err)
+	{
+		// catch errors from the code generator and pring something meaningful.
+		item.Code->ScriptPosition.Message(MSG_ERROR, "%s in %s", err.GetMessage(), item.PrintableName.GetChars());
+	}
+	FScriptPosition::Deferred = nullptr;
+}
+
 void FFunctionBuildList::DumpJit()
 {
 #ifdef HAVE_VM_JIT
@@ -1072,9 +1160,8 @@ ExpEmit FunctionCallEmitter::EmitCall(VMFunctionBuilder *build, TArray<ExpEmit>
 	{
 		// Pass a hidden type information parameter to vararg functions.
 		// It would really be nicer to actually pass real types but that'd require a far more complex interface on the compiler side than what we have.
-		uint8_t *regbuffer = (uint8_t*)ClassDataAllocator.Alloc(reginfo.Size());	// Allocate in the arena so that the pointer does not need to be maintained.
-		memcpy(regbuffer, reginfo.Data(), reginfo.Size());
-		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantAddress(regbuffer));
+		// Allocate in the arena so that the pointer does not need to be maintained.
+		build->Emit(OP_PARAM, REGT_POINTER | REGT_KONST, build->GetConstantArenaCopy(reginfo.Data(), reginfo.Size()));
 		paramcount++;
 	}
 
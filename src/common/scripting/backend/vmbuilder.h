@@ -3,6 +3,7 @@
 
 #include "dobject.h"
 #include "vmintern.h"
+#include "sc_man.h"
 #include <vector>
 #include <functional>
 
@@ -65,6 +66,11 @@ public:
 	unsigned GetConstantAddress(void *ptr);
 	unsigned GetConstantString(FString str);
 
+	// Returns a constant register that will point to a copy of the data in
+	// ClassDataAllocator. The arena is not thread safe, so the copy is only
+	// made by MakeFunction.
+	unsigned GetConstantArenaCopy(const void *data, unsigned size);
+
 	unsigned AllocConstantsInt(unsigned int count, int *values);
 	unsigned AllocConstantsFloat(unsigned int count, double *values);
 	unsigned AllocConstantsAddress(unsigned int count, void **ptrs);
@@ -119,6 +125,13 @@ private:
 	TMap<void *, unsigned> AddressConstantMap;
 	TMap<FString, unsigned> StringConstantMap;
 
+	struct FArenaConstant
+	{
+		unsigned Loc;
+		std::vector<uint8_t> Data;
+	};
+	std::vector<FArenaConstant> ArenaConstants;
+
 	int MaxParam;
 	int ActiveParam;
 
@@ -135,6 +148,7 @@ void DumpFunction(FILE *dump, VMScriptFunction *sfunc, const char *label, int la
 //
 //==========================================================================
 class FxExpression;
+struct FCompileContext;
 
 class FFunctionBuildList
 {
@@ -151,11 +165,18 @@ class FFunctionBuildList
 		int Lump;
 		VersionInfo Version;
 		bool FromDecorate;
+
+		// Only used while building.
+		FCompileContext *Context = nullptr;
+		VMFunctionBuilder *Builder = nullptr;
+		TArray<FScriptMessage> Messages;	// reported by the code generator, printed in order once all functions are done.
+		bool Emitted = false;
 	};
 
 	TArray<Item> mItems;
 
 	void DumpJit();
+	void EmitCode(Item &item);
 
 public:
 	VMFunction *AddFunction(PNamespace *curglobals, const VersionInfo &ver, PFunction *func, FxExpression *code, const FString &name, bool fromdecorate, int currentstate, int statecnt, int lumpnum);
@@ -309,6 +309,22 @@ public:
 		}
 	}
 
+	// True if nothing but the base layer is needed to draw this texture.
+	bool isSingleLayer()
+	{
+		if (shaderindex != 0) return false;
+		GetBrightmap();
+		for (auto tex : { Brightmap.get(), Detailmap.get(), Glowmap.get(), Normal.get(), Specular.get(), Metallic.get(), Roughness.get(), AmbientOcclusion.get() })
+		{
+			if (tex != nullptr) return false;
+		}
+		for (auto& tex : CustomShaderTextures)
+		{
+			if (tex != nullptr) return false;
+		}
+		return true;
+	}
+
 	FVector2 GetDetailScale() const
 	{
 		return detailScale;
@@ -45,6 +45,14 @@
 #include "textures.h"
 #include "texturemanager.h"
 #include "printf.h"
+#include "files.h"
+#include "cmdlib.h"
+#include "md5.h"
+#include "m_swap.h"
+#include "i_specialpaths.h"
+#include <zlib.h>
+#include <mutex>
+#include <memory>
 
 int upscalemask;
 
@@ -296,13 +304,9 @@ static unsigned char *hqNxAsmHelper( void (*hqNxFunction) ( int*, unsigned char*
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		HQnX_asm::InitLUTs();
-		initdone = true;
-	}
+	// The precacher upscales on worker threads so this must be initialized in a thread safe way.
+	static const bool initdone = (HQnX_asm::InitLUTs(), true);
+	(void)initdone;
 
 	HQnX_asm::CImage cImageIn;
 	cImageIn.SetImage(inputBuffer, inWidth, inHeight, 32);
@@ -323,13 +327,9 @@ static unsigned char *hqNxHelper( void (HQX_CALLCONV *hqNxFunction) ( unsigned*,
 							  int &outWidth,
 							  int &outHeight )
 {
-	static int initdone = false;
-
-	if (!initdone)
-	{
-		hqxInit();
-		initdone = true;
-	}
+	// The precacher upscales on worker threads so this must be initialized in a thread safe way.
+	static const bool initdone = (hqxInit(), true);
+	(void)initdone;
 	outWidth = N * inWidth;
 	outHeight = N *inHeight;
 
@@ -412,6 +412,208 @@ static void xbrzOldScale(size_t factor, const uint32_t* src, uint32_t* trg, int
 }
 
 
+//===========================================================================
+//
+// Upscale cache
+//
+// Upscaled images are kept in a single file in the cache directory so
+// that the scalers only have to run once per texture. Entries are keyed
+// by an MD5 of the source pixels and of all settings that affect the
+// scaler's output, and are stored deflated. The file is only ever
+// appended to; its index is built by scanning it on first use. If it is
+// damaged or has grown past gl_texture_hqresize_cachesize megabytes it
+// is started over.
+//
+// Lookups and stores can come from several threads at once when textures
+// are precached, so all access to the file and index is locked. The
+// (de)compression itself is done outside the lock.
+//
+//===========================================================================
+
+CVAR(Bool, gl_texture_hqresize_cache, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CUSTOM_CVAR(Int, gl_texture_hqresize_cachesize, 1024, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+{
+	if (self < 16) self = 16;
+	else if (self > 2000) self = 2000;
+}
+
+static const char UpscaleCacheMagic[4] = { 'Z', 'U', 'C', '1' };
+static const int UpscaleCacheHeaderSize = 32 + 3 * 4;
+
+struct FUpscaleCacheEntry
+{
+	uint32_t Offset;
+	uint32_t Size;
+	int Width;
+	int Height;
+};
+
+static std::mutex UpscaleCacheLock;
+static bool UpscaleCacheLoaded;
+static TMap<FString, FUpscaleCacheEntry> UpscaleCache;
+static FileReader UpscaleCacheReader;
+static std::unique_ptr<FileWriter> UpscaleCacheWriter;
+static uint32_t UpscaleCacheEnd;
+
+static FString UpscaleCacheName(bool create)
+{
+	FString path = M_GetCachePath(create);
+	if (create) CreatePath(path);
+	path << "/upscalecache.zdtc";
+	return path;
+}
+
+static void LoadUpscaleCache()
+{
+	if (UpscaleCacheLoaded) return;
+	UpscaleCacheLoaded = true;
+
+	FString path = UpscaleCacheName(true);
+	const long limit = gl_texture_hqresize_cachesize * 1024L * 1024L;	// capped so that this fits into a 32 bit long
+	bool valid = false;
+	char magic[4];
+
+	if (UpscaleCacheReader.OpenFile(path))
+	{
+		long length = UpscaleCacheReader.GetLength();
+		long pos = 4;
+		valid = length <= limit && UpscaleCacheReader.Read(magic, 4) == 4 && memcmp(magic, UpscaleCacheMagic, 4) == 0;
+
+		while (valid && pos < length)
+		{
+			char hexdigest[33];
+			FUpscaleCacheEntry entry;
+
+			if (pos + UpscaleCacheHeaderSize > length || UpscaleCacheReader.Read(hexdigest, 32) != 32)
+			{
+				valid = false;
+				break;
+			}
+			entry.Width = UpscaleCacheReader.ReadInt32();
+			entry.Height = UpscaleCacheReader.ReadInt32();
+			entry.Size = UpscaleCacheReader.ReadUInt32();
+			entry.Offset = uint32_t(pos + UpscaleCacheHeaderSize);
+			pos += UpscaleCacheHeaderSize + (long)entry.Size;
+			if (pos > length || entry.Width <= 0 || entry.Height <= 0)
+			{
+				// Most likely a write that was cut short.
+				valid = false;
+				break;
+			}
+			hexdigest[32] = 0;
+			UpscaleCache.Insert(hexdigest, entry);
+			UpscaleCacheReader.Seek(pos, FileReader::SeekSet);
+		}
+		UpscaleCacheEnd = uint32_t(pos);
+	}
+
+	if (valid)
+	{
+		UpscaleCacheWriter.reset(FileWriter::Open(path, true));
+	}
+	else
+	{
+		UpscaleCache.Clear();
+		UpscaleCacheReader.Close();
+		UpscaleCacheWriter.reset(FileWriter::Open(path));
+		if (UpscaleCacheWriter)
+		{
+			UpscaleCacheWriter->Write(UpscaleCacheMagic, 4);
+			UpscaleCacheEnd = 4;
+		}
+	}
+}
+
+static FString UpscaleCacheKey(const FTextureBuffer &texbuffer, int type, int mult)
+{
+	MD5Context md5;
+	int32_t params[] = { type, mult, texbuffer.mWidth, texbuffer.mHeight, xbrz_colorformat };
+	md5.Update((const uint8_t *)params, sizeof(params));
+	if (type == 4 || type == 5)
+	{
+		float options[] = { xbrz_luminanceweight, xbrz_equalcolortolerance, xbrz_centerdirectionbias,
+			xbrz_dominantdirectionthreshold, xbrz_steepdirectionthreshold };
+		md5.Update((const uint8_t *)options, sizeof(options));
+	}
+	md5.Update(texbuffer.mBuffer, texbuffer.mWidth * texbuffer.mHeight * 4);
+
+	uint8_t digest[16];
+	md5.Final(digest);
+	FString key;
+	for (int i = 0; i < 16; i++)
+	{
+		key.AppendFormat("%02x", digest[i]);
+	}
+	return key;
+}
+
+static bool ReadUpscaleCache(const FString &key, FTextureBuffer &texbuffer)
+{
+	FUpscaleCacheEntry entry;
+	TArray<uint8_t> compressed;
+	{
+		std::lock_guard<std::mutex> lock(UpscaleCacheLock);
+		LoadUpscaleCache();
+		auto found = UpscaleCache.CheckKey(key);
+		if (found == nullptr) return false;
+		entry = *found;
+
+		// Entries written during this session lie past the end the reader knows about.
+		if (!UpscaleCacheReader.isOpen() || entry.Offset + entry.Size > (uint32_t)UpscaleCacheReader.GetLength())
+		{
+			if (UpscaleCacheWriter) UpscaleCacheWriter->Flush();
+			if (!UpscaleCacheReader.OpenFile(UpscaleCacheName(false))) return false;
+		}
+		compressed.Resize(entry.Size);
+		UpscaleCacheReader.Seek(entry.Offset, FileReader::SeekSet);
+		if (UpscaleCacheReader.Read(compressed.Data(), entry.Size) != (long)entry.Size) return false;
+	}
+
+	uLongf length = entry.Width * entry.Height * 4;
+	auto buffer = new unsigned char[length];
+	if (uncompress(buffer, &length, compressed.Data(), compressed.Size()) != Z_OK || length != uLongf(entry.Width * entry.Height * 4))
+	{
+		delete[] buffer;
+		return false;
+	}
+	delete[] texbuffer.mBuffer;
+	texbuffer.mBuffer = buffer;
+	texbuffer.mWidth = entry.Width;
+	texbuffer.mHeight = entry.Height;
+	return true;
+}
+
+static void WriteUpscaleCache(const FString &key, const FTextureBuffer &texbuffer)
+{
+	uLong srclength = texbuffer.mWidth * texbuffer.mHeight * 4;
+	uLongf length = compressBound(srclength);
+	TArray<uint8_t> compressed(length, true);
+	if (compress2(compressed.Data(), &length, texbuffer.mBuffer, srclength, Z_BEST_SPEED) != Z_OK) return;
+
+	std::lock_guard<std::mutex> lock(UpscaleCacheLock);
+	LoadUpscaleCache();
+	if (!UpscaleCacheWriter || UpscaleCache.CheckKey(key)) return;
+	if (UpscaleCacheEnd + UpscaleCacheHeaderSize + length > gl_texture_hqresize_cachesize * 1024UL * 1024UL) return;
+
+	FUpscaleCacheEntry entry;
+	entry.Offset = UpscaleCacheEnd + UpscaleCacheHeaderSize;
+	entry.Size = uint32_t(length);
+	entry.Width = texbuffer.mWidth;
+	entry.Height = texbuffer.mHeight;
+
+	uint32_t header[3] = { LittleLong((uint32_t)entry.Width), LittleLong((uint32_t)entry.Height), LittleLong(entry.Size) };
+	if (UpscaleCacheWriter->Write(key.GetChars(), 32) != 32 ||
+		UpscaleCacheWriter->Write(header, sizeof(header)) != sizeof(header) ||
+		UpscaleCacheWriter->Write(compressed.Data(), length) != length)
+	{
+		// Leave the file alone from here on. The partial entry gets discarded on the next start.
+		UpscaleCacheWriter.reset();
+		return;
+	}
+	UpscaleCacheEnd = entry.Offset + entry.Size;
+	UpscaleCache.Insert(key, entry);
+}
+
 //===========================================================================
 // 
 // [BB] Upsamples the texture in texbuffer.mBuffer, frees texbuffer.mBuffer and returns
@@ -440,7 +642,20 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 	if (mult < 2 || mult > 6 || type < 1 || type > 6) return;
 	if (type < 4 && mult > 4) mult = 4;
 
-	if (!checkonly)
+	FString cachekey;
+	bool cached = false;
+	if (!checkonly && gl_texture_hqresize_cache)
+	{
+		cachekey = UpscaleCacheKey(texbuffer, type, mult);
+		cached = ReadUpscaleCache(cachekey, texbuffer);
+	}
+
+	if (checkonly)
+	{
+		texbuffer.mWidth *= mult;
+		texbuffer.mHeight *= mult;
+	}
+	else if (!cached)
 	{
 		if (type == 1)
 		{
@@ -482,11 +697,8 @@ void FTexture::CreateUpsampledTextureBuffer(FTextureBuffer &texbuffer, bool hasA
 			texbuffer.mBuffer = normalNx(mult, texbuffer.mBuffer, inWidth, inHeight, texbuffer.mWidth, texbuffer.mHeight);
 		else
 			return;
-	}
-	else
-	{
-		texbuffer.mWidth *= mult;
-		texbuffer.mHeight *= mult;
+
+		if (cachekey.IsNotEmpty()) WriteUpscaleCache(cachekey, texbuffer);
 	}
 	// Encode the scaling method in the content ID.
 	FContentIdBuilder contentId;
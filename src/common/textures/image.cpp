@@ -342,6 +342,27 @@ FImageSource *AutomapImage_TryCreate(FileReader &, int lumpnum);
 // Examines the lump contents to decide what type of texture to create,
 // and creates the texture.
 FImageSource * FImageSource::GetImage(int lumpnum, bool isflat)
+{
+	if (lumpnum == -1) return nullptr;
+
+	// An image for this lump already exists. We do not need another one.
+	if (HasImage(lumpnum)) return ImageForLump[lumpnum];
+
+	auto data = fileSystem.OpenFileReader(lumpnum);
+	if (!data.isOpen()) 
+		return nullptr;
+
+	return GetImage(data, lumpnum, isflat);
+}
+
+//==========================================================================
+//
+// Same as above but examines the passed data instead of opening the lump.
+// The data must be the lump's full contents.
+//
+//==========================================================================
+
+FImageSource * FImageSource::GetImage(FileReader &data, int lumpnum, bool isflat)
 {
 	static TexCreateInfo CreateInfo[] = {
 		{ IMGZImage_TryCreate,			false },
@@ -371,10 +392,6 @@ FImageSource * FImageSource::GetImage(int lumpnum, bool isflat)
 	// An image for this lump already exists. We do not need another one.
 	if (ImageForLump[lumpnum] != nullptr) return ImageForLump[lumpnum];
 
-	auto data = fileSystem.OpenFileReader(lumpnum);
-	if (!data.isOpen()) 
-		return nullptr;
-
 	for (size_t i = 0; i < countof(CreateInfo); i++)
 	{
 		if (!CreateInfo[i].checkflat || isflat)
@@ -6,6 +6,7 @@
 #include "memarena.h"
 
 class FImageSource;
+class FileReader;
 using PrecacheInfo = TMap<int, std::pair<int, int>>;
 extern FMemArena ImageArena;
 
@@ -92,6 +93,8 @@ public:
 
 	static void ClearImages() { ImageArena.FreeAll(); ImageForLump.Clear(); NextID = 0; }
 	static FImageSource * GetImage(int lumpnum, bool checkflat);
+	static FImageSource * GetImage(FileReader &data, int lumpnum, bool checkflat);
+	static bool HasImage(int lumpnum) { return (unsigned)lumpnum < ImageForLump.Size() && ImageForLump[lumpnum] != nullptr; }
 
 
 
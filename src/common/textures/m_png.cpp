@@ -47,6 +47,12 @@
 #include "m_swap.h"
 #include "c_cvars.h"
 #include "m_png.h"
+#include "c_dispatch.h"
+#include "printf.h"
+#include "i_time.h"
+#include "findfile.h"
+#include "cmdlib.h"
+#include "templates.h"
 
 
 // MACROS ------------------------------------------------------------------
@@ -96,7 +102,7 @@ PNGHandle::~PNGHandle ()
 static inline void MakeChunk (void *where, uint32_t type, size_t len);
 static inline void StuffPalette (const PalEntry *from, uint8_t *to);
 static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len);
-static void UnfilterRow (int width, uint8_t *dest, uint8_t *stream, uint8_t *prev, int bpp);
+static void UnfilterRow (int width, uint8_t *dest, uint8_t *row, const uint8_t *prev, int bpp, int filter);
 static void UnpackPixels (int width, int bytesPerRow, int bitdepth, const uint8_t *rowin, uint8_t *rowout, bool grayscale);
 
 // EXTERNAL DATA DECLARATIONS ----------------------------------------------
@@ -111,6 +117,7 @@ CUSTOM_CVAR(Int, png_level, 5, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 		self = 9;
 }
 CVAR(Float, png_gamma, 0.f, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
+CVAR(Bool, png_simd, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 
 // PRIVATE DATA DEFINITIONS ------------------------------------------------
 
@@ -171,6 +178,52 @@ bool M_CreatePNG (FileWriter *file, const uint8_t *buffer, const PalEntry *palet
 	return M_SaveBitmap (buffer, color_type, width, height, pitch, file);
 }
 
+//==========================================================================
+//
+// FPNGCapture :: Capture
+//
+// Copies the image so that it can be encoded after the source buffer
+// has been released. A negative pitch denotes a bottom-up image.
+//
+//==========================================================================
+
+void FPNGCapture::Capture(const uint8_t *buffer, const PalEntry *pal, ESSType color_type, int width, int height, int pitch, float gamma)
+{
+	int bytesperpixel = color_type == SS_PAL ? 1 : color_type == SS_RGB ? 3 : 4;
+	int rowsize = width * bytesperpixel;
+
+	Format = color_type;
+	Width = width;
+	Height = height;
+	Gamma = gamma;
+	if (pal != nullptr) memcpy(Palette, pal, sizeof(Palette));
+
+	Pixels.Resize(rowsize * height);
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(&Pixels[y * rowsize], buffer + (ptrdiff_t)y * pitch, rowsize);
+	}
+}
+
+//==========================================================================
+//
+// M_CreatePNG
+//
+// Encodes an image previously grabbed with FPNGCapture::Capture.
+//
+//==========================================================================
+
+bool M_CreatePNG (FileWriter *file, const FPNGCapture &capture)
+{
+	if (!capture.IsValid())
+	{
+		return M_CreateDummyPNG(file);
+	}
+	int bytesperpixel = capture.Format == SS_PAL ? 1 : capture.Format == SS_RGB ? 3 : 4;
+	return M_CreatePNG(file, capture.Pixels.Data(), capture.Format == SS_PAL ? capture.Palette : nullptr,
+		capture.Format, capture.Width, capture.Height, capture.Width * bytesperpixel, capture.Gamma);
+}
+
 //==========================================================================
 //
 // M_CreateDummyPNG
@@ -480,13 +533,14 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 
 	Byte *inputLine, *prev, *curr, *adam7buff[3], *bufferend;
 	Byte chunkbuffer[4096];
+	Byte filter;
 	z_stream stream;
 	int err;
 	int i, pass, passbuff, passpitch, passwidth;
 	bool lastIDAT;
 	int bytesPerRowIn, bytesPerRowOut;
 	int bytesPerPixel;
-	bool initpass;
+	bool initpass, gotfilter;
 
 	switch (colortype)
 	{
@@ -526,6 +580,8 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 	curr = prev = 0;
 	passwidth = passpitch = bytesPerRowIn = 0;
 	passbuff = 0;
+	filter = 0;
+	gotfilter = false;
 
 	while (err != Z_STREAM_END && pass < 8 - interlace)
 	{
@@ -560,8 +616,9 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 			}
 			curr = buffer + rowoffset*pitch + coloffset*bytesPerPixel;
 			passpitch = pitch << passheightshift[pass];
-			stream.next_out = inputLine;
-			stream.avail_out = bytesPerRowIn + 1;
+			stream.next_out = &filter;
+			stream.avail_out = 1;
+			gotfilter = false;
 		}
 		if (stream.avail_in == 0 && chunklen > 0)
 		{
@@ -577,12 +634,20 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 			return false;
 		}
 
-		if (stream.avail_out == 0)
+		if (stream.avail_out == 0 && !gotfilter)
+		{
+			// Each row is preceded by its filter type. The final passes
+			// cover whole rows of the image, so those get inflated straight
+			// into the output buffer and are unfiltered in place there.
+			gotfilter = true;
+			stream.next_out = pass >= 6 ? curr : inputLine;
+			stream.avail_out = bytesPerRowIn;
+		}
+		else if (stream.avail_out == 0)
 		{
 			if (pass >= 6)
 			{
-				// Store pixels directly into the output buffer
-				UnfilterRow (bytesPerRowIn, curr, inputLine, prev, bytesPerPixel);
+				UnfilterRow (bytesPerRowIn, curr, curr, prev, bytesPerPixel, filter);
 				prev = curr;
 			}
 			else
@@ -592,7 +657,7 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 				int colstep, x;
 
 				// Store pixels into a temporary buffer
-				UnfilterRow (bytesPerRowIn, adam7buff[passbuff], inputLine, prev, bytesPerPixel);
+				UnfilterRow (bytesPerRowIn, adam7buff[passbuff], inputLine, prev, bytesPerPixel, filter);
 				prev = adam7buff[passbuff];
 				passbuff ^= 1;
 				in = prev;
@@ -650,8 +715,9 @@ bool M_ReadIDAT (FileReader &file, uint8_t *buffer, int width, int height, int p
 				++pass;
 				initpass = true;
 			}
-			stream.next_out = inputLine;
-			stream.avail_out = bytesPerRowIn + 1;
+			stream.next_out = &filter;
+			stream.avail_out = 1;
+			gotfilter = false;
 		}
 
 		if (chunklen == 0 && !lastIDAT)
@@ -1067,6 +1133,121 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 	return true;
 }
 
+#if (defined(_M_X64) || defined(_M_IX86) || defined(__i386__) || defined(__amd64__)) && !defined(NO_SSE)
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#include <emmintrin.h>
+
+#define PNG_UNFILTER_SSE2
+
+//==========================================================================
+//
+// SSE2 unfiltering
+//
+// Sub, Average and Paeth depend on the pixel just decoded, so only one
+// pixel can be done per step. That still beats the scalar code for 3 and
+// 4 byte pixels because all channels of a pixel are handled at once and
+// the Paeth predictor selection becomes branchless. Up has no such
+// dependency and is done 16 bytes at a time for every pixel size.
+//
+// dest may be the same as row.
+//
+//==========================================================================
+
+template<int bpp> static inline __m128i LoadPixel(const uint8_t *p)
+{
+	uint32_t v = 0;
+	memcpy(&v, p, bpp);
+	return _mm_cvtsi32_si128(v);
+}
+
+template<int bpp> static inline void StorePixel(uint8_t *p, __m128i v)
+{
+	uint32_t x = _mm_cvtsi128_si32(v);
+	memcpy(p, &x, bpp);
+}
+
+static void UnfilterUp_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	int x = 0;
+	for (; x + 16 <= width; x += 16)
+	{
+		__m128i r = _mm_loadu_si128((const __m128i *)(row + x));
+		__m128i b = _mm_loadu_si128((const __m128i *)(prev + x));
+		_mm_storeu_si128((__m128i *)(dest + x), _mm_add_epi8(r, b));
+	}
+	for (; x < width; ++x)
+	{
+		dest[x] = row[x] + prev[x];
+	}
+}
+
+template<int bpp> static void UnfilterSub_SSE2(int width, uint8_t *dest, const uint8_t *row)
+{
+	__m128i a = _mm_setzero_si128();
+	for (int x = 0; x < width; x += bpp)
+	{
+		a = _mm_add_epi8(a, LoadPixel<bpp>(row + x));
+		StorePixel<bpp>(dest + x, a);
+	}
+}
+
+template<int bpp> static void UnfilterAverage_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	const __m128i one = _mm_set1_epi8(1);
+	__m128i a = _mm_setzero_si128();
+	for (int x = 0; x < width; x += bpp)
+	{
+		__m128i b = LoadPixel<bpp>(prev + x);
+		// _mm_avg_epu8 rounds up, so take off the rounding bit to get (a+b)/2.
+		__m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+		a = _mm_add_epi8(LoadPixel<bpp>(row + x), avg);
+		StorePixel<bpp>(dest + x, a);
+	}
+}
+
+template<int bpp> static void UnfilterPaeth_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128i a = zero, c = zero;		// The left neighbors are 0 for the first pixel.
+	for (int x = 0; x < width; x += bpp)
+	{
+		__m128i b = _mm_unpacklo_epi8(LoadPixel<bpp>(prev + x), zero);
+		__m128i pa = _mm_sub_epi16(b, c);
+		__m128i pb = _mm_sub_epi16(a, c);
+		__m128i pc = _mm_add_epi16(pa, pb);
+		pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+		pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+		pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+		// Same tie breaking as the scalar version: a, then b, then c.
+		__m128i usec = _mm_cmpgt_epi16(pb, pc);
+		__m128i bc = _mm_or_si128(_mm_andnot_si128(usec, b), _mm_and_si128(usec, c));
+		__m128i usebc = _mm_cmpgt_epi16(pa, _mm_min_epi16(pb, pc));
+		__m128i pred = _mm_or_si128(_mm_andnot_si128(usebc, a), _mm_and_si128(usebc, bc));
+
+		__m128i out = _mm_add_epi8(LoadPixel<bpp>(row + x), _mm_packus_epi16(pred, pred));
+		StorePixel<bpp>(dest + x, out);
+		a = _mm_unpacklo_epi8(out, zero);
+		c = b;
+	}
+}
+
+template<int bpp> static bool UnfilterRow_SSE2(int width, uint8_t *dest, const uint8_t *row, const uint8_t *prev, int filter)
+{
+	switch (filter)
+	{
+	case 1:		UnfilterSub_SSE2<bpp>(width, dest, row);				return true;
+	case 3:		UnfilterAverage_SSE2<bpp>(width, dest, row, prev);	return true;
+	case 4:		UnfilterPaeth_SSE2<bpp>(width, dest, row, prev);		return true;
+	default:	return false;
+	}
+}
+
+#endif
+
 //==========================================================================
 //
 // UnfilterRow
@@ -1074,14 +1255,32 @@ static bool WriteIDAT (FileWriter *file, const uint8_t *data, int len)
 // Unfilters the given row. Unknown filter types are silently ignored.
 // bpp is bytes per pixel, not bits per pixel.
 // width is in bytes, not pixels.
+// dest may be the same as row, which is how rows that are inflated
+// directly into the image get unfiltered.
 //
 //==========================================================================
 
-void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp)
+void UnfilterRow (int width, uint8_t *dest, uint8_t *row, const uint8_t *prev, int bpp, int filter)
 {
 	int x;
 
-	switch (*row++)
+#ifdef PNG_UNFILTER_SSE2
+	if (png_simd)
+	{
+		if (filter == 2)
+		{
+			UnfilterUp_SSE2(width, dest, row, prev);
+			return;
+		}
+		if (width % bpp == 0)
+		{
+			if (bpp == 4 && UnfilterRow_SSE2<4>(width, dest, row, prev, filter)) return;
+			if (bpp == 3 && UnfilterRow_SSE2<3>(width, dest, row, prev, filter)) return;
+		}
+	}
+#endif
+
+	switch (filter)
 	{
 	case 1:		// Sub
 		x = bpp;
@@ -1147,7 +1346,10 @@ void UnfilterRow (int width, uint8_t *dest, uint8_t *row, uint8_t *prev, int bpp
 		break;
 
 	default:	// Treat everything else as filter type 0 (none)
-		memcpy (dest, row, width);
+		if (dest != row)
+		{
+			memcpy (dest, row, width);
+		}
 		break;
 	}
 }
@@ -1292,3 +1494,158 @@ static void UnpackPixels (int width, int bytesPerRow, int bitdepth, const uint8_
 		}
 	}
 }
+
+//==========================================================================
+//
+// BenchDecodePNG
+//
+// Decodes a PNG held in memory into a tightly packed buffer, the same way
+// the texture loader does.
+//
+//==========================================================================
+
+static bool BenchDecodePNG(const TArray<uint8_t> &data, TArray<uint8_t> &pixels)
+{
+	FileReader fr;
+	if (!fr.OpenMemory(data.Data(), data.Size()))
+	{
+		return false;
+	}
+	PNGHandle *png = M_VerifyPNG(fr);
+	if (png == nullptr)
+	{
+		return false;
+	}
+
+	bool ok = false;
+	if (M_FindPNGChunk(png, MAKE_ID('I','H','D','R')) == 13)
+	{
+		auto &file = png->File;
+		int width = file.ReadInt32BE();
+		int height = file.ReadInt32BE();
+		uint8_t bitdepth = file.ReadUInt8();
+		uint8_t colortype = file.ReadUInt8();
+		uint8_t compression = file.ReadUInt8();
+		uint8_t filter = file.ReadUInt8();
+		uint8_t interlace = file.ReadUInt8();
+		int bytesPerPixel = colortype == 2 ? 3 : colortype == 4 ? 2 : colortype == 6 ? 4 : 1;
+
+		if (width > 0 && height > 0 && width <= 32768 && height <= 32768 && bitdepth <= 8 &&
+			compression == 0 && filter == 0 && interlace <= 1)
+		{
+			unsigned int len = M_FindPNGChunk(png, MAKE_ID('I','D','A','T'));
+			if (len > 0)
+			{
+				pixels.Resize(width * height * bytesPerPixel);
+				ok = M_ReadIDAT(file, pixels.Data(), width, height, width * bytesPerPixel, bitdepth, colortype, interlace, len);
+			}
+		}
+	}
+	delete png;
+	return ok;
+}
+
+//==========================================================================
+//
+// CCMD benchpng
+//
+// Decodes every PNG in a directory with both the scalar and the SIMD
+// unfilters, reports the best total time of each and checks that both
+// produced the same pixels.
+//
+//==========================================================================
+
+CCMD(benchpng)
+{
+	if (argv.argc() < 2)
+	{
+		Printf("Usage: benchpng <directory> [runs]\n");
+		return;
+	}
+
+	FString dir = argv[1];
+	FixPathSeperator(dir);
+	if (dir.Len() > 0 && dir.Back() != '/') dir += '/';
+	int count = argv.argc() > 2 ? clamp(atoi(argv[2]), 1, 100) : 3;
+
+	TArray<TArray<uint8_t>> files;
+	TArray<FString> names;
+	findstate_t find;
+	FString match = dir + "*.png";
+	void *handle = I_FindFirst(match.GetChars(), &find);
+	if (handle != (void *)-1)
+	{
+		do
+		{
+			if (I_FindAttr(&find) & FA_DIREC) continue;
+			FString name = I_FindName(&find);
+			FileReader fr;
+			if (fr.OpenFile((dir + name).GetChars()))
+			{
+				files.Push(fr.Read());
+				names.Push(name);
+			}
+		} while (I_FindNext(handle, &find) == 0);
+		I_FindClose(handle);
+	}
+	if (files.Size() == 0)
+	{
+		Printf("No PNG files found in %s\n", dir.GetChars());
+		return;
+	}
+
+	static const struct { const char *name; bool simd; } modes[] =
+	{
+		{ "scalar", false },
+		{ "simd", true },
+	};
+
+	bool savedsimd = png_simd;
+	TArray<uint8_t> pixels;
+	TArray<uint32_t> firsthashes;
+	bool same = true;
+	int failed = 0;
+
+	Printf("Decoding %u PNG files from %s, %d runs each\n", files.Size(), dir.GetChars(), count);
+	for (auto &mode : modes)
+	{
+		uint64_t best = UINT64_MAX;
+		uint64_t bytes = 0;
+		TArray<uint32_t> hashes;
+
+		png_simd = mode.simd;
+		for (int i = 0; i < count; i++)
+		{
+			uint64_t total = 0;
+			bytes = 0;
+			hashes.Clear();
+			for (unsigned j = 0; j < files.Size(); j++)
+			{
+				uint64_t start = I_nsTime();
+				bool ok = BenchDecodePNG(files[j], pixels);
+				total += I_nsTime() - start;
+				if (ok)
+				{
+					bytes += pixels.Size();
+					hashes.Push(CalcCRC32(pixels.Data(), pixels.Size()));
+				}
+				else
+				{
+					if (i == 0 && &mode == &modes[0])
+					{
+						Printf("Could not decode %s\n", names[j].GetChars());
+						failed++;
+					}
+					hashes.Push(0);
+				}
+			}
+			best = MIN(best, total);
+		}
+		if (&mode == &modes[0]) firsthashes = hashes;
+		else if (!(hashes == firsthashes)) same = false;
+		Printf("%-8s %9.3f ms  %8.1f MB/s\n", mode.name, best / 1e6, best > 0 ? bytes * 1e3 / best : 0.);
+	}
+	png_simd = savedsimd;
+	if (failed > 0) Printf("%d files could not be decoded\n", failed);
+	Printf("%s\n", same ? "All code paths produced the same pixels." : TEXTCOLOR_RED "Code paths produced different pixels!");
+}
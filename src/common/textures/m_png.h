@@ -35,6 +35,7 @@
 
 #include <stdio.h>
 #include "zstring.h"
+#include "tarray.h"
 #include "files.h"
 #include "palentry.h"
 #include "basics.h"
@@ -71,6 +72,24 @@ bool M_FinishPNG (FileWriter *file);
 
 bool M_SaveBitmap(const uint8_t *from, ESSType color_type, int width, int height, int pitch, FileWriter *file);
 
+// An image grabbed from the screen whose PNG encoding is performed later,
+// possibly on another thread. Rows are always stored top-down.
+struct FPNGCapture
+{
+	TArray<uint8_t> Pixels;
+	PalEntry Palette[256];
+	ESSType Format = SS_RGB;
+	int Width = 0;
+	int Height = 0;
+	float Gamma = 1.f;
+
+	void Capture(const uint8_t *buffer, const PalEntry *pal, ESSType color_type, int width, int height, int pitch, float gamma);
+	bool IsValid() const { return Width > 0 && Height > 0; }
+};
+
+// Encodes a captured image. Writes a dummy PNG if nothing was captured.
+bool M_CreatePNG (FileWriter *file, const FPNGCapture &capture);
+
 // PNG Reading --------------------------------------------------------------
 
 struct PNGHandle
@@ -326,6 +326,35 @@ void V_ApplyLuminosityTranslation(int translation, uint8_t *buffer, int size);
 FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 {
 	FTextureBuffer result;
+
+	for (unsigned i = 0; i < PreparedBuffers.Size(); i++)
+	{
+		if (PreparedBuffers[i].translation == translation && PreparedBuffers[i].flags == flags)
+		{
+			result = std::move(*PreparedBuffers[i].buffer);
+			delete PreparedBuffers[i].buffer;
+			PreparedBuffers.Delete(i);
+			return result;
+		}
+	}
+
+	bool transparent;
+	result = CreateRawTexBuffer(translation, flags, transparent);
+	UpscaleTexBuffer(result, transparent, flags);
+	FinishTexBuffer(result, flags);
+	return result;
+}
+
+//===========================================================================
+// 
+//	Creates the buffer without any postprocessing.
+//
+//===========================================================================
+
+FTextureBuffer FTexture::CreateRawTexBuffer(int translation, int flags, bool &transparent)
+{
+	FTextureBuffer result;
+	transparent = false;
 	if (flags & CTF_Indexed)
 	{
 		// Indexed textures will never be translated and never be scaled.
@@ -396,17 +425,56 @@ FTextureBuffer FTexture::CreateTexBuffer(int translation, int flags)
 		result.mBuffer = buffer;
 		result.mWidth = W;
 		result.mHeight = H;
+		transparent = !!isTransparent;
+	}
+	return result;
 
-		// Only do postprocessing for image-backed textures. (i.e. not for the burn texture which can also pass through here.)
-		if (GetImage() && flags & CTF_ProcessData)
-		{
-			if (flags & CTF_Upscale) CreateUpsampledTextureBuffer(result, !!isTransparent, checkonly);
+}
 
-			if (!checkonly) ProcessData(result.mBuffer, result.mWidth, result.mHeight, false);
-		}
+//===========================================================================
+// 
+//	Postprocessing of the buffer. Only done for image-backed textures.
+//	(i.e. not for the burn texture which can also pass through here.)
+//
+//	Upscaling does not touch the texture itself so that it can be done
+//	on a worker thread.
+//
+//===========================================================================
+
+void FTexture::UpscaleTexBuffer(FTextureBuffer &texbuffer, bool transparent, int flags)
+{
+	if (GetImage() && !(flags & CTF_Indexed) && (flags & CTF_ProcessData) && (flags & CTF_Upscale))
+	{
+		CreateUpsampledTextureBuffer(texbuffer, transparent, !!(flags & CTF_CheckOnly));
 	}
-	return result;
+}
+
+void FTexture::FinishTexBuffer(FTextureBuffer &texbuffer, int flags)
+{
+	if (GetImage() && !(flags & (CTF_Indexed | CTF_CheckOnly)) && (flags & CTF_ProcessData))
+	{
+		ProcessData(texbuffer.mBuffer, texbuffer.mWidth, texbuffer.mHeight, false);
+	}
+}
 
+//===========================================================================
+// 
+//	The next CreateTexBuffer call with the same parameters returns the
+//	stored buffer instead of creating a new one.
+//
+//===========================================================================
+
+void FTexture::StorePreparedBuffer(int translation, int flags, FTextureBuffer &&texbuffer)
+{
+	auto buffer = new FTextureBuffer;
+	*buffer = std::move(texbuffer);
+	PreparedBuffers.Push({ translation, flags, buffer });
+}
+
+void FTexture::ClearPreparedBuffers()
+{
+	for (auto &pb : PreparedBuffers) delete pb.buffer;
+	PreparedBuffers.Clear();
 }
 
 //===========================================================================
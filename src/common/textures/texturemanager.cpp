@@ -47,6 +47,9 @@
 #include "vectors.h"
 #include "animtexture.h"
 #include "formats/multipatchtexture.h"
+#include "startuptrace.h"
+#include "parallel_for.h"
+#include "v_2datlas.h"
 
 FTextureManager TexMan;
 
@@ -86,6 +89,7 @@ FTextureManager::~FTextureManager ()
 
 void FTextureManager::DeleteAll()
 {
+	Atlas2D::Clear();
 	FImageSource::ClearImages();
 	for (unsigned int i = 0; i < Textures.Size(); ++i)
 	{
@@ -910,6 +914,108 @@ void FTextureManager::LoadTextureX(int wadnum, FMultipatchTextureBuilder &build)
 	build.AddTexturesLumps (texlump1, texlump2, pnames);
 }
 
+//==========================================================================
+//
+// PrefetchImages
+//
+// Most of the time spent adding a Zip's textures goes into decompressing
+// the graphics so that their headers can be examined. This reads the
+// compressed data of everything the following steps are going to look at,
+// inflates it on all cores and probes the images from memory, in lump
+// order so that the result is the same each time. AddTexturesForWad then
+// finds the images already created and does not need to touch the lumps
+// again.
+//
+// Flats are left alone because they must be probed with flat detection
+// enabled, and so is anything that is not compressed. Lumps that fail
+// to decompress here are also left to the regular code, which reports
+// the error.
+//
+//==========================================================================
+
+static void PrefetchImages(int wadnum)
+{
+	int firsttx = fileSystem.GetFirstEntry(wadnum);
+	int lasttx = fileSystem.GetLastEntry(wadnum);
+	TArray<int> lumps;
+	FString Name;
+
+	if (firsttx == -1 || lasttx == -1)
+	{
+		return;
+	}
+
+	for (int i = firsttx; i <= lasttx; i++)
+	{
+		if (!(fileSystem.GetFileFlags(i) & LUMPF_COMPRESSED) || FImageSource::HasImage(i)) continue;
+
+		int ns = fileSystem.GetFileNamespace(i);
+		if (ns != ns_sprites && ns != ns_patches && ns != ns_newtextures && ns != ns_graphics && ns != ns_hires && ns < ns_firstskin) continue;
+
+		// Don't bother with this lump if something later overrides it.
+		fileSystem.GetFileShortName(Name, i);
+		if (fileSystem.CheckNumForName(Name, ns) != i) continue;
+		lumps.Push(i);
+	}
+
+	// Work in batches so that only a limited amount of data is held in memory at once.
+	const unsigned BATCH_BYTES = 64 << 20;
+	TArray<FCompressedBuffer> raw;
+	TArray<TArray<uint8_t>> data;
+
+	for (unsigned start = 0; start < lumps.Size(); )
+	{
+		unsigned end = start;
+		unsigned bytes = 0;
+		while (end < lumps.Size() && (end == start || bytes + fileSystem.FileLength(lumps[end]) <= BATCH_BYTES))
+		{
+			bytes += fileSystem.FileLength(lumps[end++]);
+		}
+
+		int count = end - start;
+		raw.Resize(count);
+		data.Resize(count);
+		for (int j = 0; j < count; j++)
+		{
+			raw[j] = fileSystem.GetRawData(lumps[start + j]);
+		}
+
+		parallel_for(count, [&](int j)
+		{
+			auto &cbuf = raw[j];
+
+			// Bzip2 reports internal errors through a global so it has to stay on the main thread.
+			if (cbuf.mSize == 0 || (cbuf.mMethod != METHOD_DEFLATE && cbuf.mMethod != METHOD_LZMA)) return;
+			try
+			{
+				FileReader mr, frz;
+				mr.OpenMemory(cbuf.mBuffer, cbuf.mCompressedSize);
+				if (frz.OpenDecompressor(mr, cbuf.mSize, cbuf.mMethod, false, nullptr))
+				{
+					data[j].Resize(cbuf.mSize);
+					if (frz.Read(data[j].Data(), cbuf.mSize) != (FileReader::Size)cbuf.mSize) data[j].Reset();
+				}
+			}
+			catch (const std::exception &)
+			{
+				data[j].Reset();
+			}
+		});
+
+		for (int j = 0; j < count; j++)
+		{
+			FileReader fr;
+			if (raw[j].mMethod == METHOD_STORED) fr.OpenMemory(raw[j].mBuffer, raw[j].mSize);
+			else if (data[j].Size() > 0) fr.OpenMemory(data[j].Data(), data[j].Size());
+
+			if (fr.isOpen()) FImageSource::GetImage(fr, lumps[start + j], false);
+			raw[j].Clean();
+			data[j].Reset();
+		}
+		start = end;
+	}
+}
+
 //==========================================================================
 //
 // FTextureManager :: AddTexturesForWad
@@ -924,6 +1030,9 @@ void FTextureManager::AddTexturesForWad(int wadnum, FMultipatchTextureBuilder &b
 
 	FirstTextureForFile.Push(firsttexture);
 
+	// Probe the images of compressed lumps up front and in parallel.
+	PrefetchImages(wadnum);
+
 	// First step: Load sprites
 	AddGroup(wadnum, ns_sprites, ETextureType::Sprite);
 
@@ -1173,6 +1282,7 @@ FImageSource* CreateEmptyTexture();
 
 void FTextureManager::Init(void (*progressFunc_)(), void (*checkForHacks)(BuildInfo&))
 {
+	TRACE_SCOPE("FTextureManager::Init");
 	progressFunc = progressFunc_;
 	DeleteAll();
 	//if (BuildTileFiles.Size() == 0) CountBuildTiles ();
@@ -219,6 +219,14 @@ protected:
 	int8_t bTranslucent = -1;
 	int8_t areacount = 0;			// this is capped at 4 sections.
 
+	struct PreparedBuffer
+	{
+		int translation;
+		int flags;
+		FTextureBuffer *buffer;
+	};
+	TArray<PreparedBuffer> PreparedBuffers;	// buffers the precacher has already created for CreateTexBuffer.
+
 
 public:
 
@@ -286,6 +294,14 @@ public:
 
 public:
 	FTextureBuffer CreateTexBuffer(int translation, int flags = 0);
+
+	// CreateTexBuffer in separate steps, so that the precacher can upscale on worker threads.
+	// Only UpscaleTexBuffer may be called off the main thread.
+	FTextureBuffer CreateRawTexBuffer(int translation, int flags, bool &transparent);
+	void UpscaleTexBuffer(FTextureBuffer &texbuffer, bool transparent, int flags);
+	void FinishTexBuffer(FTextureBuffer &texbuffer, int flags);
+	void StorePreparedBuffer(int translation, int flags, FTextureBuffer &&texbuffer);
+	void ClearPreparedBuffers();
 	virtual bool DetermineTranslucency();
 	bool GetTranslucency()
 	{
@@ -16,9 +16,6 @@
 #ifndef SFMT_SSE2_H
 #define SFMT_SSE2_H
 
-PRE_ALWAYS static __m128i mm_recursion(__m128i *a, __m128i *b, __m128i c,
-									   __m128i d, __m128i mask) ALWAYSINLINE;
-
 /**
 * This function represents the recursion formula.
 * @param a a 128-bit part of the interal state array
@@ -28,7 +25,7 @@ PRE_ALWAYS static __m128i mm_recursion(__m128i *a, __m128i *b, __m128i c,
 * @param mask 128-bit mask
 * @return output
 */
-PRE_ALWAYS static __m128i mm_recursion(__m128i *a, __m128i *b, 
+inline static __m128i mm_recursion(__m128i *a, __m128i *b, 
 									   __m128i c, __m128i d, __m128i mask) {
 										   __m128i v, x, y, z;
 
@@ -49,22 +46,23 @@ PRE_ALWAYS static __m128i mm_recursion(__m128i *a, __m128i *b,
 * This function fills the internal state array with pseudorandom
 * integers.
 */
-inline static void gen_rand_all(void) {
+void SFMTObj::GenRandAll()
+{
 	int i;
 	__m128i r, r1, r2, mask;
 	mask = _mm_set_epi32(MSK4, MSK3, MSK2, MSK1);
 
-	r1 = _mm_load_si128(&sfmt[N - 2].si);
-	r2 = _mm_load_si128(&sfmt[N - 1].si);
-	for (i = 0; i < N - POS1; i++) {
-		r = mm_recursion(&sfmt[i].si, &sfmt[i + POS1].si, r1, r2, mask);
-		_mm_store_si128(&sfmt[i].si, r);
+	r1 = _mm_load_si128(&sfmt.w128[SFMT::N - 2].si);
+	r2 = _mm_load_si128(&sfmt.w128[SFMT::N - 1].si);
+	for (i = 0; i < SFMT::N - POS1; i++) {
+		r = mm_recursion(&sfmt.w128[i].si, &sfmt.w128[i + POS1].si, r1, r2, mask);
+		_mm_store_si128(&sfmt.w128[i].si, r);
 		r1 = r2;
 		r2 = r;
 	}
-	for (; i < N; i++) {
-		r = mm_recursion(&sfmt[i].si, &sfmt[i + POS1 - N].si, r1, r2, mask);
-		_mm_store_si128(&sfmt[i].si, r);
+	for (; i < SFMT::N; i++) {
+		r = mm_recursion(&sfmt.w128[i].si, &sfmt.w128[i + POS1 - SFMT::N].si, r1, r2, mask);
+		_mm_store_si128(&sfmt.w128[i].si, r);
 		r1 = r2;
 		r2 = r;
 	}
@@ -77,42 +75,43 @@ inline static void gen_rand_all(void) {
 * @param array an 128-bit array to be filled by pseudorandom numbers.  
 * @param size number of 128-bit pesudorandom numbers to be generated.
 */
-inline static void gen_rand_array(w128_t *array, int size) {
+void SFMTObj::GenRandArray(w128_t *array, int size)
+{
 	int i, j;
 	__m128i r, r1, r2, mask;
 	mask = _mm_set_epi32(MSK4, MSK3, MSK2, MSK1);
 
-	r1 = _mm_load_si128(&sfmt[N - 2].si);
-	r2 = _mm_load_si128(&sfmt[N - 1].si);
-	for (i = 0; i < N - POS1; i++) {
-		r = mm_recursion(&sfmt[i].si, &sfmt[i + POS1].si, r1, r2, mask);
+	r1 = _mm_load_si128(&sfmt.w128[SFMT::N - 2].si);
+	r2 = _mm_load_si128(&sfmt.w128[SFMT::N - 1].si);
+	for (i = 0; i < SFMT::N - POS1; i++) {
+		r = mm_recursion(&sfmt.w128[i].si, &sfmt.w128[i + POS1].si, r1, r2, mask);
 		_mm_store_si128(&array[i].si, r);
 		r1 = r2;
 		r2 = r;
 	}
-	for (; i < N; i++) {
-		r = mm_recursion(&sfmt[i].si, &array[i + POS1 - N].si, r1, r2, mask);
+	for (; i < SFMT::N; i++) {
+		r = mm_recursion(&sfmt.w128[i].si, &array[i + POS1 - SFMT::N].si, r1, r2, mask);
 		_mm_store_si128(&array[i].si, r);
 		r1 = r2;
 		r2 = r;
 	}
 	/* main loop */
-	for (; i < size - N; i++) {
-		r = mm_recursion(&array[i - N].si, &array[i + POS1 - N].si, r1, r2,
+	for (; i < size - SFMT::N; i++) {
+		r = mm_recursion(&array[i - SFMT::N].si, &array[i + POS1 - SFMT::N].si, r1, r2,
 			mask);
 		_mm_store_si128(&array[i].si, r);
 		r1 = r2;
 		r2 = r;
 	}
-	for (j = 0; j < 2 * N - size; j++) {
-		r = _mm_load_si128(&array[j + size - N].si);
-		_mm_store_si128(&sfmt[j].si, r);
+	for (j = 0; j < 2 * SFMT::N - size; j++) {
+		r = _mm_load_si128(&array[j + size - SFMT::N].si);
+		_mm_store_si128(&sfmt.w128[j].si, r);
 	}
 	for (; i < size; i++) {
-		r = mm_recursion(&array[i - N].si, &array[i + POS1 - N].si, r1, r2,
+		r = mm_recursion(&array[i - SFMT::N].si, &array[i + POS1 - SFMT::N].si, r1, r2,
 			mask);
 		_mm_store_si128(&array[i].si, r);
-		_mm_store_si128(&sfmt[j++].si, r);
+		_mm_store_si128(&sfmt.w128[j++].si, r);
 		r1 = r2;
 		r2 = r;
 	}
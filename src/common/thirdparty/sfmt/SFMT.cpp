@@ -43,9 +43,9 @@ inline static uint32_t func2(uint32_t x);
 inline static void swap(w128_t *array, int size);
 #endif
 
-// These SIMD versions WILL NOT work as-is. I'm not even sure SSE2 is
-// safe to provide as a runtime option without significant changes to
-// how the state is stored, since the VC++ docs warn that:
+// The Altivec version WILL NOT work as-is. The SSE2 version has been
+// adapted to SFMTObj and is only compiled in when SSE2 is guaranteed to
+// be there (see SFMT.h), since the VC++ docs warn that:
 //    Using variables of type __m128i will cause the compiler to generate
 //    the SSE2 movdqa instruction. This instruction does not cause a fault
 //    on Pentium III processors but will result in silent failure, with
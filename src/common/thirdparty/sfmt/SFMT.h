@@ -62,6 +62,13 @@
 /*------------------------------------------------------
   128-bit SIMD data type for Altivec, SSE2 or standard C
   ------------------------------------------------------*/
+// SSE2 is part of every x86-64 CPU, so use it whenever the compiler
+// may. 32-bit builds only get it when compiled for SSE2.
+#if !defined(HAVE_SSE2) && !defined(HAVE_ALTIVEC) && !defined(NO_SSE) && \
+	(defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define HAVE_SSE2 1
+#endif
+
 #if defined(HAVE_ALTIVEC)
   #if !defined(__APPLE__)
     #include <altivec.h>
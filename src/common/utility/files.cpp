@@ -417,16 +417,16 @@ bool FileReader::OpenMemoryArray(std::function<bool(TArray<uint8_t>&)> getter)
 //
 //==========================================================================
 
-bool FileWriter::OpenDirect(const char *filename)
+bool FileWriter::OpenDirect(const char *filename, bool append)
 {
-	File = myfopen(filename, "wb");
+	File = myfopen(filename, append ? "ab" : "wb");
 	return (File != NULL);
 }
 
-FileWriter *FileWriter::Open(const char *filename)
+FileWriter *FileWriter::Open(const char *filename, bool append)
 {
 	FileWriter *fwrit = new FileWriter();
-	if (fwrit->OpenDirect(filename))
+	if (fwrit->OpenDirect(filename, append))
 	{
 		return fwrit;
 	}
@@ -329,7 +329,7 @@ protected:
 class FileWriter
 {
 protected:
-	bool OpenDirect(const char *filename);
+	bool OpenDirect(const char *filename, bool append = false);
 
 public:
 	FileWriter(FILE *f = nullptr) // if passed, this writer will take over the file.
@@ -341,12 +341,16 @@ public:
 		Close();
 	}
 
-	static FileWriter *Open(const char *filename);
+	static FileWriter *Open(const char *filename, bool append = false);
 
 	virtual size_t Write(const void *buffer, size_t len);
 	virtual long Tell();
 	virtual long Seek(long offset, int mode);
 	size_t Printf(const char *fmt, ...) GCCPRINTF(2,3);
+	virtual void Flush()
+	{
+		if (File != NULL) fflush(File);
+	}
 	virtual void Close()
 	{
 		if (File != NULL) fclose(File);
@@ -53,6 +53,13 @@
 #define _realloc_dbg(p,s,b,f,l)	realloc(p,s)
 #endif
 
+static inline void Track(void *block)
+{
+	size_t size = _msize(block);
+	GC::AllocBytes += size;
+	GC::TotalAllocBytes += size;
+}
+
 #ifndef _DEBUG
 #if !defined(__solaris__) && !defined(__OpenBSD__) && !defined(__DragonFly__)
 void *M_Malloc(size_t size)
@@ -62,7 +69,7 @@ void *M_Malloc(size_t size)
 	if (block == NULL)
 		I_FatalError("Could not malloc %zu bytes", size);
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 
@@ -77,7 +84,7 @@ void *M_Realloc(void *memblock, size_t size)
 	{
 		I_FatalError("Could not realloc %zu bytes", size);
 	}
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 #else
@@ -92,7 +99,7 @@ void *M_Malloc(size_t size)
 	*sizeStore = size;
 	block = sizeStore+1;
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 
@@ -115,7 +122,7 @@ void *M_Realloc(void *memblock, size_t size)
 	*sizeStore = size;
 	block = sizeStore+1;
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 #endif
@@ -132,7 +139,7 @@ void *M_Malloc_Dbg(size_t size, const char *file, int lineno)
 	if (block == NULL)
 		I_FatalError("Could not malloc %zu bytes in %s, line %d", size, file, lineno);
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 
@@ -147,7 +154,7 @@ void *M_Realloc_Dbg(void *memblock, size_t size, const char *file, int lineno)
 	{
 		I_FatalError("Could not realloc %zu bytes in %s, line %d", size, file, lineno);
 	}
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 #else
@@ -162,7 +169,7 @@ void *M_Malloc_Dbg(size_t size, const char *file, int lineno)
 	*sizeStore = size;
 	block = sizeStore+1;
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 
@@ -186,7 +193,7 @@ void *M_Realloc_Dbg(void *memblock, size_t size, const char *file, int lineno)
 	*sizeStore = size;
 	block = sizeStore+1;
 
-	GC::AllocBytes += _msize(block);
+	Track(block);
 	return block;
 }
 #endif
@@ -201,6 +208,11 @@ void M_Free (void *block)
 		free(block);
 	}
 }
+
+void M_FreeUntracked (void *block)
+{
+	free(block);
+}
 #else
 void M_Free (void *block)
 {
@@ -210,5 +222,20 @@ void M_Free (void *block)
 		free(((size_t*) block)-1);
 	}
 }
+
+void M_FreeUntracked (void *block)
+{
+	if(block != NULL)
+	{
+		free(((size_t*) block)-1);
+	}
+}
 #endif
 
+void M_Untrack (void *block)
+{
+	if (block != NULL)
+	{
+		GC::AllocBytes -= _msize(block);
+	}
+}
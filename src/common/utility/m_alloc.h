@@ -84,4 +84,9 @@ inline void* M_Calloc(size_t v1, size_t v2)
 
 void M_Free (void *memblock);
 
+// M_Free in two parts: the block no longer counts as allocated right away,
+// and gets released later, possibly on another thread.
+void M_Untrack (void *memblock);
+void M_FreeUntracked (void *memblock);
+
 #endif //__M_ALLOC_H__
@@ -25,45 +25,25 @@
 #ifndef PARALLEL_FOR_H_INCLUDED
 #define PARALLEL_FOR_H_INCLUDED
 
-#ifdef HAVE_PARALLEL_FOR
-
-#include <ppl.h>
-
-template <typename Index, typename Function>
-inline void parallel_for(const Index first, const Index last, const Index step, const Function& function)
-{
-	concurrency::parallel_for(first, last, step, function);
-}
-
-#elif defined HAVE_DISPATCH_APPLY
-
-#include <dispatch/dispatch.h>
+#include "threadpool.h"
 
+// Calls function(i) for first <= i < last in increments of step, spread
+// over the engine's thread pool.
 template <typename Index, typename Function>
 inline void parallel_for(const Index first, const Index last, const Index step, const Function& function)
 {
-	const dispatch_queue_t queue = dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0);
+	if (last <= first) return;
 
-	dispatch_apply((last - first) / step + 1, queue, ^(size_t slice)
+	const int count = int((last - first + step - 1) / step);
+	ThreadPool::ParallelFor(count, 0, [&](int begin, int end)
 	{
-		function(slice * step);
+		for (int i = begin; i < end; i++)
+		{
+			function(Index(first + i * step));
+		}
 	});
 }
 
-#else // Generic loop with optional OpenMP parallelization
-
-template <typename Index, typename Function>
-inline void parallel_for(const Index first, const Index last, const Index step, const Function& function)
-{
-#pragma omp parallel for
-	for (Index i = first; i < last; i += step)
-	{
-		function(i);
-	}
-}
-
-#endif // HAVE_PARALLEL_FOR
-
 template <typename Index, typename Function>
 inline void parallel_for(const Index count, const Function& function)
 {
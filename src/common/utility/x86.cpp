@@ -65,6 +65,17 @@ FString DumpCPUInfo(const CPUInfo *cpu)
 #define __cpuid(output, func) __cpuidex(output, func, 0)
 #endif
 
+static uint64_t GetXCR0()
+{
+#ifdef _MSC_VER
+	return _xgetbv(0);
+#else
+	uint32_t lo, hi;
+	__asm__ __volatile__("xgetbv" : "=a" (lo), "=d" (hi) : "c" (0));
+	return lo | ((uint64_t)hi << 32);
+#endif
+}
+
 void CheckCPUID(CPUInfo *cpu)
 {
 	int foo[4];
@@ -95,6 +106,13 @@ void CheckCPUID(CPUInfo *cpu)
 
 	cpu->HyperThreading = (foo[3] & (1 << 28)) > 0;
 
+	// OSXSAVE only means XGETBV is available. The OS also has to have
+	// enabled the SSE and AVX state in XCR0.
+	if (cpu->bOSXSAVE && cpu->bAVX)
+	{
+		cpu->bOSAVX = (GetXCR0() & 6) == 6;
+	}
+
 	// If CLFLUSH instruction is supported, get the real cache line size.
 	if (foo[3] & (1 << 19))
 	{
@@ -4,7 +4,7 @@
 #include "basics.h"
 #include "zstring.h"
 
-struct CPUInfo	// 92 bytes
+struct CPUInfo	// 116 bytes
 {
 	union
 	{
@@ -211,6 +211,7 @@ struct CPUInfo	// 92 bytes
 	uint8_t AMDModel;
 	uint8_t AMDFamily;
 	uint8_t bIsAMD;
+	uint8_t bOSAVX;		// The OS saves the YMM registers, so AVX and AVX2 code can run.
 
 	union
 	{
@@ -118,6 +118,10 @@
 #include "hw_clock.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "doomfont.h"
+#include "startuptrace.h"
+#include "g_benchmark.h"
+#include "g_syncstream.h"
+#include "threadpool.h"
 
 #ifdef __unix__
 #include "i_system.h"  // for SHARE_DIR
@@ -1266,6 +1270,7 @@ void D_DoomLoop ()
 				I_StartFrame ();
 			}
 			I_SetFrameTime();
+			ThreadPool::ApplyResize();
 
 			// process one or more tics
 			if (singletics)
@@ -3096,6 +3101,15 @@ static int D_DoomMain_Internal (void)
 	
 	std::set_new_handler(NewFailure);
 	const char *batchout = Args->CheckValue("-errorlog");
+
+	// -tracestartup [file] records the startup phases as a Chrome trace.
+	p = Args->CheckParm("-tracestartup");
+	if (p > 0)
+	{
+		const char *tracefile = Args->GetArg(p + 1);
+		if (tracefile == nullptr || *tracefile == '-' || *tracefile == '+') tracefile = "startuptrace.json";
+		StartupTrace::Enable(tracefile);
+	}
 	
 	C_InitConsole(80*8, 25*8, false);
 	I_DetectOS();
@@ -3119,6 +3133,9 @@ static int D_DoomMain_Internal (void)
 		Printf("\n");
 	}
 
+	G_InitBenchmark();
+	if (G_InitSyncStream()) return 0;	// -synccompare does nothing else.
+
 	if (Args->CheckParm("-hashfiles"))
 	{
 		const char *filename = "fileinfo.txt";
@@ -3179,6 +3196,7 @@ static int D_DoomMain_Internal (void)
 
 	do
 	{
+		StartupTrace::Begin("D_DoomMain");
 		PClass::StaticInit();
 		PType::StaticInit();
 
@@ -3570,6 +3588,8 @@ static int D_DoomMain_Internal (void)
 
 			if (Args->CheckParm("-norun") || batchrun)
 			{
+				StartupTrace::End();
+				StartupTrace::Write();
 				return 1337; // special exit
 			}
 
@@ -3581,6 +3601,14 @@ static int D_DoomMain_Internal (void)
 			UpdateJoystickMenu(NULL);
 			UpdateVRModes();
 
+			StartupTrace::End();
+			StartupTrace::Write();
+
+			if (Args->CheckParm("-warmnodecache"))
+			{
+				P_WarmNodeCache(nullptr);
+			}
+
 			v = Args->CheckValue ("-loadgame");
 			if (v)
 			{
@@ -3723,6 +3751,10 @@ void D_Cleanup()
 		G_CheckDemoStatus();
 	}
 
+	// Don't leave a half-written savegame behind.
+	G_WaitForPendingSave();
+	P_StopNodeCacheWarming();
+
 	// Music and sound should be stopped first
 	S_StopMusic(true);
 	S_ClearSoundData();
@@ -45,8 +45,33 @@
 
 EventManager staticEventManager;
 
+// Calls the event on every handler that overrides it. Handlers that get
+// destroyed while the event is sent are skipped. Handlers added meanwhile
+// only get events that start after the outermost one has finished.
+template<class Func>
+static void CallSubscribers(EventManager* manager, EEventSubscription ev, bool backwards, Func call)
+{
+	auto& list = manager->GetSubscribers(ev);
+
+	// A handler may throw, so this can't just be a decrement at the end.
+	struct FDispatchScope
+	{
+		int& Depth;
+		FDispatchScope(int& depth) : Depth(depth) { Depth++; }
+		~FDispatchScope() { Depth--; }
+	} scope(manager->Dispatching);
+
+	for (unsigned i = 0; i < list.Size(); i++)
+	{
+		DStaticEventHandler* handler = list[backwards ? list.Size() - 1 - i : i];
+		if (!(handler->ObjectFlags & OF_EuthanizeMe))
+			call(handler);
+	}
+}
+
 void EventManager::CallOnRegister()
 {
+	SubscribersChanged = true;
 	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
 	{
 		handler->OnRegister();
@@ -119,6 +144,7 @@ bool EventManager::RegisterHandler(DStaticEventHandler* handler)
 		handler->ObjectFlags |= OF_Transient;
 	}
 
+	SubscribersChanged = true;
 	return true;
 }
 
@@ -152,6 +178,7 @@ bool EventManager::UnregisterHandler(DStaticEventHandler* handler)
 		LastEventHandler = handler->prev;
 		GC::WriteBarrier(handler->prev);
 	}
+	SubscribersChanged = true;
 	if (handler->IsStatic())
 	{
 		handler->ObjectFlags &= ~OF_Transient;
@@ -271,6 +298,7 @@ void EventManager::Shutdown()
 		handler->Destroy();
 	}
 	FirstEventHandler = LastEventHandler = nullptr;
+	SubscribersChanged = true;
 }
 
 #define DEFINE_EVENT_LOOPER(name, play) void EventManager::name() \
@@ -280,6 +308,12 @@ void EventManager::Shutdown()
 		handler->name(); \
 }
 
+#define DEFINE_SUBSCRIBED_EVENT_LOOPER(name, play) void EventManager::name() \
+{ \
+	if (ShouldCallStatic(play)) staticEventManager.name(); \
+	CallSubscribers(this, ESUB_##name, false, [&](DStaticEventHandler* handler) { handler->name(); }); \
+}
+
 
 // note for the functions below.
 // *Unsafe is executed on EVERY map load/close, including savegame loading, etc.
@@ -315,8 +349,7 @@ void EventManager::WorldThingSpawned(AActor* actor)
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingSpawned(actor);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldThingSpawned(actor);
+	CallSubscribers(this, ESUB_WorldThingSpawned, false, [&](DStaticEventHandler* handler) { handler->WorldThingSpawned(actor); });
 }
 
 void EventManager::WorldThingDied(AActor* actor, AActor* inflictor)
@@ -327,8 +360,7 @@ void EventManager::WorldThingDied(AActor* actor, AActor* inflictor)
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingDied(actor, inflictor);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldThingDied(actor, inflictor);
+	CallSubscribers(this, ESUB_WorldThingDied, false, [&](DStaticEventHandler* handler) { handler->WorldThingDied(actor, inflictor); });
 }
 
 void EventManager::WorldThingGround(AActor* actor, FState* st)
@@ -339,8 +371,7 @@ void EventManager::WorldThingGround(AActor* actor, FState* st)
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingGround(actor, st);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldThingGround(actor, st);
+	CallSubscribers(this, ESUB_WorldThingGround, false, [&](DStaticEventHandler* handler) { handler->WorldThingGround(actor, st); });
 }
 
 void EventManager::WorldThingRevived(AActor* actor)
@@ -351,8 +382,7 @@ void EventManager::WorldThingRevived(AActor* actor)
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingRevived(actor);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldThingRevived(actor);
+	CallSubscribers(this, ESUB_WorldThingRevived, false, [&](DStaticEventHandler* handler) { handler->WorldThingRevived(actor); });
 }
 
 void EventManager::WorldThingDamaged(AActor* actor, AActor* inflictor, AActor* source, int damage, FName mod, int flags, DAngle angle)
@@ -363,8 +393,7 @@ void EventManager::WorldThingDamaged(AActor* actor, AActor* inflictor, AActor* s
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingDamaged(actor, inflictor, source, damage, mod, flags, angle);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldThingDamaged(actor, inflictor, source, damage, mod, flags, angle);
+	CallSubscribers(this, ESUB_WorldThingDamaged, false, [&](DStaticEventHandler* handler) { handler->WorldThingDamaged(actor, inflictor, source, damage, mod, flags, angle); });
 }
 
 void EventManager::WorldThingDestroyed(AActor* actor)
@@ -377,8 +406,7 @@ void EventManager::WorldThingDestroyed(AActor* actor)
 	if (!(actor->ObjectFlags & OF_Spawned))
 		return;
 
-	for (DStaticEventHandler* handler = LastEventHandler; handler; handler = handler->prev)
-		handler->WorldThingDestroyed(actor);
+	CallSubscribers(this, ESUB_WorldThingDestroyed, true, [&](DStaticEventHandler* handler) { handler->WorldThingDestroyed(actor); });
 
 	if (ShouldCallStatic(true)) staticEventManager.WorldThingDestroyed(actor);
 }
@@ -387,24 +415,21 @@ void EventManager::WorldLinePreActivated(line_t* line, AActor* actor, int activa
 {
 	if (ShouldCallStatic(true)) staticEventManager.WorldLinePreActivated(line, actor, activationType, shouldactivate);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldLinePreActivated(line, actor, activationType, shouldactivate);
+	CallSubscribers(this, ESUB_WorldLinePreActivated, false, [&](DStaticEventHandler* handler) { handler->WorldLinePreActivated(line, actor, activationType, shouldactivate); });
 }
 
 void EventManager::WorldLineActivated(line_t* line, AActor* actor, int activationType)
 {
 	if (ShouldCallStatic(true)) staticEventManager.WorldLineActivated(line, actor, activationType);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->WorldLineActivated(line, actor, activationType);
+	CallSubscribers(this, ESUB_WorldLineActivated, false, [&](DStaticEventHandler* handler) { handler->WorldLineActivated(line, actor, activationType); });
 }
 
 int EventManager::WorldSectorDamaged(sector_t* sector, AActor* source, int damage, FName damagetype, int part, DVector3 position, bool isradius)
 {
 	if (ShouldCallStatic(true)) staticEventManager.WorldSectorDamaged(sector, source, damage, damagetype, part, position, isradius);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		damage = handler->WorldSectorDamaged(sector, source, damage, damagetype, part, position, isradius);
+	CallSubscribers(this, ESUB_WorldSectorDamaged, false, [&](DStaticEventHandler* handler) { damage = handler->WorldSectorDamaged(sector, source, damage, damagetype, part, position, isradius); });
 	return damage;
 }
 
@@ -412,8 +437,7 @@ int EventManager::WorldLineDamaged(line_t* line, AActor* source, int damage, FNa
 {
 	if (ShouldCallStatic(true)) staticEventManager.WorldLineDamaged(line, source, damage, damagetype, side, position, isradius);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		damage = handler->WorldLineDamaged(line, source, damage, damagetype, side, position, isradius);
+	CallSubscribers(this, ESUB_WorldLineDamaged, false, [&](DStaticEventHandler* handler) { damage = handler->WorldLineDamaged(line, source, damage, damagetype, side, position, isradius); });
 	return damage;
 }
 
@@ -528,16 +552,14 @@ void EventManager::RenderOverlay(EHudState state)
 {
 	if (ShouldCallStatic(false)) staticEventManager.RenderOverlay(state);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->RenderOverlay(state);
+	CallSubscribers(this, ESUB_RenderOverlay, false, [&](DStaticEventHandler* handler) { handler->RenderOverlay(state); });
 }
 
 void EventManager::RenderUnderlay(EHudState state)
 {
 	if (ShouldCallStatic(false)) staticEventManager.RenderUnderlay(state);
 
-	for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
-		handler->RenderUnderlay(state);
+	CallSubscribers(this, ESUB_RenderUnderlay, false, [&](DStaticEventHandler* handler) { handler->RenderUnderlay(state); });
 }
 
 bool EventManager::CheckUiProcessors()
@@ -575,8 +597,7 @@ bool EventManager::CheckReplacement( PClassActor *replacee, PClassActor **replac
 	// This is play scope but unlike in-game events needs to be handled like UI by static handlers.
 	if (ShouldCallStatic(false)) final = staticEventManager.CheckReplacement(replacee, replacement);
 
-	for (DStaticEventHandler *handler = FirstEventHandler; handler; handler = handler->next)
-		handler->CheckReplacement(replacee,replacement,&final);
+	CallSubscribers(this, ESUB_CheckReplacement, false, [&](DStaticEventHandler* handler) { handler->CheckReplacement(replacee, replacement, &final); });
 	return final;
 }
 
@@ -585,8 +606,7 @@ bool EventManager::CheckReplacee(PClassActor **replacee, PClassActor *replacemen
 	bool final = false;
 	if (ShouldCallStatic(false)) final = staticEventManager.CheckReplacee(replacee, replacement);
 
-	for (DStaticEventHandler *handler = FirstEventHandler; handler; handler = handler->next)
-		handler->CheckReplacee(replacee, replacement, &final);
+	CallSubscribers(this, ESUB_CheckReplacee, false, [&](DStaticEventHandler* handler) { handler->CheckReplacee(replacee, replacement, &final); });
 	return final;
 }
 
@@ -601,10 +621,10 @@ void EventManager::NewGame()
 
 // normal event loopers (non-special, argument-less)
 DEFINE_EVENT_LOOPER(RenderFrame, false)
-DEFINE_EVENT_LOOPER(WorldLightning, true)
-DEFINE_EVENT_LOOPER(WorldTick, true)
-DEFINE_EVENT_LOOPER(UiTick, false)
-DEFINE_EVENT_LOOPER(PostUiTick, false)
+DEFINE_SUBSCRIBED_EVENT_LOOPER(WorldLightning, true)
+DEFINE_SUBSCRIBED_EVENT_LOOPER(WorldTick, true)
+DEFINE_SUBSCRIBED_EVENT_LOOPER(UiTick, false)
+DEFINE_SUBSCRIBED_EVENT_LOOPER(PostUiTick, false)
 
 // declarations
 IMPLEMENT_CLASS(DStaticEventHandler, false, true);
@@ -720,6 +740,61 @@ static bool isEmptyInt(VMFunction *func)
 	return (code == nullptr || code->word == (0x00048000|OP_RET));
 }
 
+// The callback names for EEventSubscription.
+static const char* const SubscriptionNames[NUM_EVENTSUBSCRIPTIONS] =
+{
+	"WorldThingSpawned",
+	"WorldThingDied",
+	"WorldThingGround",
+	"WorldThingRevived",
+	"WorldThingDamaged",
+	"WorldThingDestroyed",
+	"WorldLinePreActivated",
+	"WorldLineActivated",
+	"WorldSectorDamaged",
+	"WorldLineDamaged",
+	"WorldLightning",
+	"WorldTick",
+	"UiTick",
+	"PostUiTick",
+	"RenderOverlay",
+	"RenderUnderlay",
+	"CheckReplacement",
+	"CheckReplacee",
+};
+
+TArray<DStaticEventHandler*>& EventManager::GetSubscribers(EEventSubscription ev)
+{
+	if (SubscribersChanged && Dispatching == 0)
+	{
+		static unsigned VIndices[NUM_EVENTSUBSCRIPTIONS];
+		static bool indicesfound = false;
+		if (!indicesfound)
+		{
+			for (int i = 0; i < NUM_EVENTSUBSCRIPTIONS; i++)
+			{
+				VIndices[i] = GetVirtualIndex(RUNTIME_CLASS(DStaticEventHandler), SubscriptionNames[i]);
+				assert(VIndices[i] != ~0u);
+			}
+			indicesfound = true;
+		}
+
+		for (auto& list : Subscribers) list.Clear();
+		for (DStaticEventHandler* handler = FirstEventHandler; handler; handler = handler->next)
+		{
+			auto& virtuals = handler->GetClass()->Virtuals;
+			for (int i = 0; i < NUM_EVENTSUBSCRIPTIONS; i++)
+			{
+				VMFunction* func = virtuals.Size() > VIndices[i] ? virtuals[VIndices[i]] : nullptr;
+				if (func != nullptr && !isEmpty(func))
+					Subscribers[i].Push(handler);
+			}
+		}
+		SubscribersChanged = false;
+	}
+	return Subscribers[ev];
+}
+
 // ===========================================
 //
 //  Event handlers
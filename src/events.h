@@ -203,12 +203,48 @@ struct FReplacedEvent
 	bool IsFinal;
 };
 
+// Events that are only sent to the handlers that override them, because
+// they happen too often to walk the whole handler list each time.
+enum EEventSubscription
+{
+	ESUB_WorldThingSpawned,
+	ESUB_WorldThingDied,
+	ESUB_WorldThingGround,
+	ESUB_WorldThingRevived,
+	ESUB_WorldThingDamaged,
+	ESUB_WorldThingDestroyed,
+	ESUB_WorldLinePreActivated,
+	ESUB_WorldLineActivated,
+	ESUB_WorldSectorDamaged,
+	ESUB_WorldLineDamaged,
+	ESUB_WorldLightning,
+	ESUB_WorldTick,
+	ESUB_UiTick,
+	ESUB_PostUiTick,
+	ESUB_RenderOverlay,
+	ESUB_RenderUnderlay,
+	ESUB_CheckReplacement,
+	ESUB_CheckReplacee,
+
+	NUM_EVENTSUBSCRIPTIONS
+};
+
 struct EventManager
 {
 	FLevelLocals *Level = nullptr;
 	DStaticEventHandler* FirstEventHandler = nullptr;
 	DStaticEventHandler* LastEventHandler = nullptr;
 
+	// Handlers per event in list order. These are non-owning pointers that
+	// are not marked by the GC; the handler list above keeps the handlers
+	// alive. Any change to that list sets SubscribersChanged, and the arrays
+	// are rebuilt before the next event is sent. While an event is being sent
+	// (Dispatching > 0) they are left alone, so that a handler registered or
+	// removed by a nested event can't shift the outer loop's position.
+	TArray<DStaticEventHandler*> Subscribers[NUM_EVENTSUBSCRIPTIONS];
+	bool SubscribersChanged = true;
+	int Dispatching = 0;
+
 	EventManager() = default;
 	EventManager(FLevelLocals *l) { Level = l; }
 	~EventManager() { Shutdown(); }
@@ -302,12 +338,16 @@ struct EventManager
 	FWorldEvent SetupWorldEvent();
 	FRenderEvent SetupRenderEvent();
 
+	// handlers that override this event's callback
+	TArray<DStaticEventHandler*>& GetSubscribers(EEventSubscription ev);
+
 	void SetOwnerForHandlers()
 	{
 		for (DStaticEventHandler* existinghandler = FirstEventHandler; existinghandler; existinghandler = existinghandler->next)
 		{
 			existinghandler->owner = this;
 		}
+		SubscribersChanged = true;
 	}
 
 };
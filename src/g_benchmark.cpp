@@ -0,0 +1,223 @@
+/*
+** g_benchmark.cpp
+** Per-tic playsim timing for headless benchmark runs
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <algorithm>
+#include <math.h>
+#include "g_benchmark.h"
+#include "m_argv.h"
+#include "files.h"
+#include "printf.h"
+#include "i_time.h"
+#include "engineerrors.h"
+#include "doomstat.h"
+#include "g_levellocals.h"
+
+extern cycle_t VMCycles[10];
+extern FString defdemoname;
+extern bool timingdemo;
+
+bool benchmarking;
+cycle_t BenchCycles[NUM_BENCHTIMERS];
+
+static const char *const BenchTimerNames[NUM_BENCHTIMERS] = { "thinkers", "scripts", "sight", "movement", "sound" };
+
+struct FBenchTic
+{
+	double Playsim;
+	double Timers[NUM_BENCHTIMERS];
+};
+
+static FString BenchFile;
+static int BenchTics;
+static TArray<FBenchTic> Tics;
+static TArray<FString> Maps;
+
+static uint64_t TicStart;
+static double TimerStart[NUM_BENCHTIMERS];
+static double VMStart;
+static double LastSound;
+
+//==========================================================================
+//
+// Called before the subsystems are set up, so that the implied
+// parameters get picked up by them.
+//
+//==========================================================================
+
+void G_InitBenchmark()
+{
+	const char *file = Args->CheckValue("-bench");
+	if (file == nullptr) return;
+
+	BenchFile = file;
+	const char *tics = Args->CheckValue("-benchtics");
+	BenchTics = tics ? atoi(tics) : 0;
+
+	if (!Args->CheckParm("-nodraw")) Args->AppendArg("-nodraw");
+	// -softsound benchmarks the sound code with the software mixer instead.
+	if (!Args->CheckParm("-nosound") && !Args->CheckParm("-softsound")) Args->AppendArg("-nosound");
+	nodrawers = true;
+	singletics = true;
+
+	for (auto &timer : BenchCycles) timer.Reset();
+	LastSound = 0;
+	benchmarking = true;
+}
+
+//==========================================================================
+//
+// Brackets P_Ticker. Sound is measured from the end of the previous tic,
+// because the listener update runs after the tic.
+//
+//==========================================================================
+
+void G_BenchmarkBeginTic()
+{
+	if (!benchmarking) return;
+
+	if (Tics.Size() == 0) LastSound = BenchCycles[BENCH_Sound].Time();
+	if (Maps.Size() == 0 || Maps.Last().CompareNoCase(primaryLevel->MapName) != 0)
+	{
+		Maps.Push(primaryLevel->MapName);
+	}
+	for (int i = 0; i < NUM_BENCHTIMERS; i++) TimerStart[i] = BenchCycles[i].Time();
+	VMStart = VMCycles[0].Time();
+	TicStart = I_nsTime();
+}
+
+void G_BenchmarkEndTic()
+{
+	if (!benchmarking) return;
+
+	FBenchTic tic;
+	tic.Playsim = (I_nsTime() - TicStart) / 1e6;
+	for (int i = 0; i < NUM_BENCHTIMERS; i++)
+	{
+		tic.Timers[i] = (BenchCycles[i].Time() - TimerStart[i]) * 1e3;
+	}
+	tic.Timers[BENCH_Scripts] += (VMCycles[0].Time() - VMStart) * 1e3;
+	tic.Timers[BENCH_Sound] = (BenchCycles[BENCH_Sound].Time() - LastSound) * 1e3;
+	LastSound = BenchCycles[BENCH_Sound].Time();
+	Tics.Push(tic);
+
+	if (BenchTics > 0 && (int)Tics.Size() >= BenchTics)
+	{
+		G_FinishBenchmark();
+		throw CExitEvent(0);
+	}
+}
+
+//==========================================================================
+//
+// Writes the results and stops measuring.
+//
+//==========================================================================
+
+static FString Escape(const char *str)
+{
+	FString out;
+	for (; *str; str++)
+	{
+		if (*str == '"' || *str == '\\') out << '\\';
+		if ((unsigned char)*str < 32) continue;
+		out << *str;
+	}
+	return out;
+}
+
+static void WriteSummary(FileWriter *fw, const char *name, TArray<double> &values, bool last)
+{
+	std::sort(values.begin(), values.end());
+
+	double total = 0;
+	for (auto v : values) total += v;
+
+	// nearest rank
+	auto percentile = [&](double p)
+	{
+		int index = (int)ceil(p / 100 * values.Size()) - 1;
+		return values[clamp<int>(index, 0, values.Size() - 1)];
+	};
+
+	fw->Printf("\t\t\"%s\": { \"total\": %.4f, \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f }%s\n",
+		name, total, total / values.Size(), values[0], percentile(50), percentile(90), percentile(95), percentile(99), values.Last(), last ? "" : ",");
+}
+
+void G_FinishBenchmark()
+{
+	if (!benchmarking) return;
+	benchmarking = false;
+
+	if (Tics.Size() == 0)
+	{
+		Printf(TEXTCOLOR_RED "Benchmark ended without running any tics\n");
+		return;
+	}
+
+	auto fw = FileWriter::Open(BenchFile.GetChars());
+	if (fw == nullptr)
+	{
+		Printf(TEXTCOLOR_RED "Could not write benchmark results to %s\n", BenchFile.GetChars());
+		return;
+	}
+
+	fw->Printf("{\n");
+	fw->Printf("\t\"demo\": \"%s\",\n", timingdemo ? Escape(defdemoname.GetChars()).GetChars() : "");
+	fw->Printf("\t\"maps\": [");
+	for (unsigned i = 0; i < Maps.Size(); i++)
+	{
+		fw->Printf("%s\"%s\"", i > 0 ? ", " : "", Escape(Maps[i].GetChars()).GetChars());
+	}
+	fw->Printf("],\n");
+	fw->Printf("\t\"tics\": %u,\n", Tics.Size());
+	fw->Printf("\t\"unit\": \"ms\",\n");
+
+	TArray<double> values(Tics.Size(), true);
+	for (unsigned i = 0; i < Tics.Size(); i++) values[i] = Tics[i].Playsim;
+	fw->Printf("\t\"summary\": {\n");
+	WriteSummary(fw, "playsim", values, false);
+	for (int t = 0; t < NUM_BENCHTIMERS; t++)
+	{
+		for (unsigned i = 0; i < Tics.Size(); i++) values[i] = Tics[i].Timers[t];
+		WriteSummary(fw, BenchTimerNames[t], values, t == NUM_BENCHTIMERS - 1);
+	}
+	fw->Printf("\t},\n");
+
+	fw->Printf("\t\"per_tic\": [\n");
+	for (unsigned i = 0; i < Tics.Size(); i++)
+	{
+		auto &tic = Tics[i];
+		fw->Printf("\t\t{ \"playsim\": %.4f", tic.Playsim);
+		for (int t = 0; t < NUM_BENCHTIMERS; t++)
+		{
+			fw->Printf(", \"%s\": %.4f", BenchTimerNames[t], tic.Timers[t]);
+		}
+		fw->Printf(" }%s\n", i + 1 < Tics.Size() ? "," : "");
+	}
+	fw->Printf("\t]\n}\n");
+	delete fw;
+
+	Printf("Benchmark results for %u tics written to %s\n", Tics.Size(), BenchFile.GetChars());
+	Tics.Reset();
+	Maps.Reset();
+}
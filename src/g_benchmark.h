@@ -0,0 +1,59 @@
+#pragma once
+
+#include "stats.h"
+
+//==========================================================================
+//
+// Playsim benchmark
+//
+// -bench <file> times every playsim tic of a -timedemo run, or of the
+// first -benchtics <n> tics of a map started with +map or -warp, and
+// writes the results as JSON when the run ends. It implies -nodraw and
+// -nosound and runs the tics back to back, so that nothing but the
+// playsim is measured. With -softsound the software mixer is used
+// instead of -nosound, so the sound timer includes the mixing.
+//
+// The subsystem timers overlap: thinker time includes the movement,
+// sight, script and sound time spent inside thinkers.
+//
+//==========================================================================
+
+enum EBenchTimer
+{
+	BENCH_Thinkers,
+	BENCH_Scripts,		// ACS only, the ZScript VM's time is taken from its own counter
+	BENCH_Sight,
+	BENCH_Movement,
+	BENCH_Sound,
+
+	NUM_BENCHTIMERS
+};
+
+extern bool benchmarking;
+extern cycle_t BenchCycles[NUM_BENCHTIMERS];
+
+void G_InitBenchmark();
+void G_BenchmarkBeginTic();
+void G_BenchmarkEndTic();
+void G_FinishBenchmark();
+
+// Times the rest of the scope while a benchmark is running.
+class FBenchClock
+{
+	EBenchTimer Timer;
+	bool Active;
+
+public:
+	FBenchClock(EBenchTimer timer)
+	{
+		Timer = timer;
+		Active = benchmarking;
+		if (Active) BenchCycles[Timer].Clock();
+	}
+	~FBenchClock()
+	{
+		if (Active) BenchCycles[Timer].Unclock();
+	}
+	FBenchClock(const FBenchClock &) = delete;
+	FBenchClock &operator=(const FBenchClock &) = delete;
+};
@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stddef.h>
 #include <memory>
+#include <thread>
+#include <atomic>
 
 #include "i_time.h"
 #include "templates.h"
@@ -86,6 +88,8 @@
 #include "d_buttons.h"
 #include "hwrenderer/scene/hw_drawinfo.h"
 #include "doommenu.h"
+#include "g_benchmark.h"
+#include "g_syncstream.h"
 
 
 static FRandom pr_dmspawn ("DMSpawn");
@@ -105,6 +109,7 @@ void	G_DoWorldDone (void);
 void	G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description);
 void	G_DoAutoSave ();
 void	G_DoQuickSave ();
+void	G_CheckPendingSave ();
 
 void STAT_Serialize(FSerializer &file);
 bool WriteZip(const char *filename, TArray<FString> &filenames, TArray<FCompressedBuffer> &content);
@@ -117,6 +122,7 @@ CVAR (Bool, storesavepic, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (Bool, longsavemessages, true, CVAR_ARCHIVE|CVAR_GLOBALCONFIG)
 CVAR (String, save_dir, "", CVAR_ARCHIVE|CVAR_GLOBALCONFIG);
 CVAR (Bool, cl_waitforsave, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
+CVAR (Bool, cl_backgroundsave, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);	// compress and write savegames on a separate thread.
 CVAR (Bool, enablescriptscreenshot, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG);
 EXTERN_CVAR (Float, con_midtime);
 
@@ -1129,6 +1135,9 @@ void G_Ticker ()
 		AddCommandString ("toggle vid_fullscreen");
 	}
 
+	G_CheckPendingSave();
+	P_UpdateNodeCacheWarming();
+
 	// do things to change the game state
 	oldgamestate = gamestate;
 	while (gameaction != ga_nothing)
@@ -1285,7 +1294,10 @@ void G_Ticker ()
 	switch (gamestate)
 	{
 	case GS_LEVEL:
+		G_BenchmarkBeginTic ();
 		P_Ticker ();
+		G_BenchmarkEndTic ();
+		G_SyncStreamTic ();
 		primaryLevel->automap->Ticker ();
 		break;
 
@@ -1965,6 +1977,9 @@ void G_DoLoadGame ()
 	hidecon = gameaction == ga_loadgamehidecon;
 	gameaction = ga_nothing;
 
+	// Make sure we do not try to read a savegame that is still being written.
+	G_WaitForPendingSave();
+
 	std::unique_ptr<FResourceFile> resfile(FResourceFile::OpenResourceFile(savename.GetChars(), true, true));
 	if (resfile == nullptr)
 	{
@@ -2301,26 +2316,197 @@ static void PutSaveComment (FSerializer &arc)
 	arc.AddString("Comment", comment);
 }
 
-static void PutSavePic (FileWriter *file, int width, int height)
+static void PutSavePic (FPNGCapture *capture, int width, int height)
 {
-	if (width <= 0 || height <= 0 || !storesavepic)
-	{
-		M_CreateDummyPNG (file);
-	}
-	else
+	if (width > 0 && height > 0 && storesavepic)
 	{
 		D_Render([&]()
 			{
-				WriteSavePic(&players[consoleplayer], file, width, height);
+				WriteSavePic(&players[consoleplayer], capture, width, height);
 			}, false);
 	}
+	// else leave the capture empty so that a dummy PNG gets written.
 }
 
-void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description)
+//==========================================================================
+//
+// Background savegame writing
+//
+// Everything that depends on the game state is captured on the game thread
+// by G_DoSaveGame. Compressing the JSON data, encoding the savepic and
+// writing the zip are then done by a worker thread. There is never more
+// than one save in flight: a new save, loading a game and shutting down
+// all wait for the previous one to finish first.
+//
+//==========================================================================
+
+struct FSaveGameJob
+{
+	FString Filename;
+	FString Description;
+	bool OkForQuicksave = false;
+	bool ForceQuicksave = false;
+
+	FPNGCapture SavePic;
+	TArray<FString> PicText;			// keyword/text pairs for the savepic's tEXt chunks.
+
+	TArray<FString> Filenames;
+	TArray<FCompressedBuffer> Content;	// owned by the job. Entries with a null buffer get filled from RawContent.
+	TArray<FString> RawContent;			// uncompressed data that still needs to be deflated.
+
+	std::atomic<bool> Done = { false };
+	bool Succeeded = false;
+	FString Error;
+
+	~FSaveGameJob()
+	{
+		for (auto &c : Content) c.Clean();
+	}
+
+	void AddRaw(const char *name, FString &&data)
+	{
+		Filenames.Push(name);
+		Content.Push({ 0, 0, 0, 0, 0, nullptr });
+		RawContent.Push(std::move(data));
+	}
+
+	void Run();
+	bool Write();
+};
+
+static std::unique_ptr<FSaveGameJob> PendingSave;
+static std::thread SaveThread;
+
+//==========================================================================
+//
+// Hub snapshots may get discarded or replaced while the job is running
+// so the job needs its own copy of them.
+//
+//==========================================================================
+
+static FCompressedBuffer CopyCompressedBuffer(const FCompressedBuffer &src)
+{
+	FCompressedBuffer copy = src;
+	copy.mBuffer = new char[src.mCompressedSize];
+	memcpy(copy.mBuffer, src.mBuffer, src.mCompressedSize);
+	return copy;
+}
+
+//==========================================================================
+//
+// This runs on the savegame thread and must not touch any game state.
+// Nothing may escape the thread, so errors only fail the save.
+//
+//==========================================================================
+
+void FSaveGameJob::Run()
 {
-	TArray<FCompressedBuffer> savegame_content;
-	TArray<FString> savegame_filenames;
+	try
+	{
+		Succeeded = Write();
+	}
+	catch (CEngineError &err)
+	{
+		Error = err.GetMessage();
+	}
+	catch (std::exception &err)
+	{
+		Error = err.what();
+	}
+	catch (...)
+	{
+		Error = "Unknown error";
+	}
+	Done = true;
+}
 
+bool FSaveGameJob::Write()
+{
+	BufferWriter savepic;
+	M_CreatePNG(&savepic, SavePic);
+	for (unsigned i = 0; i + 1 < PicText.Size(); i += 2)
+	{
+		M_AppendPNGText(&savepic, PicText[i], PicText[i + 1]);
+	}
+	M_FinishPNG(&savepic);
+	SavePic.Pixels.Reset();
+
+	auto picdata = savepic.GetBuffer();
+	unsigned picsize = picdata->Size();
+	FCompressedBuffer bufpng = { picsize, picsize, METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, picdata->Data(), picsize)), new char[picsize] };
+	memcpy(bufpng.mBuffer, picdata->Data(), picsize);
+	Content[0] = bufpng;
+
+	for (unsigned i = 0; i < Content.Size(); i++)
+	{
+		if (Content[i].mBuffer == nullptr)
+		{
+			Content[i] = FSerializer::CompressBuffer(RawContent[i].GetChars(), (unsigned)RawContent[i].Len());
+			RawContent[i] = "";
+		}
+	}
+
+	if (WriteZip(Filename, Filenames, Content))
+	{
+		// Check whether the file is ok by trying to open it.
+		FResourceFile *test = FResourceFile::OpenResourceFile(Filename, true);
+		if (test != nullptr)
+		{
+			delete test;
+			return true;
+		}
+	}
+	return false;
+}
+
+//==========================================================================
+//
+// Blocks until the pending save has been written and reports the result.
+// This must be called from the game thread.
+//
+//==========================================================================
+
+void G_WaitForPendingSave()
+{
+	if (PendingSave == nullptr) return;
+
+	if (SaveThread.joinable())
+	{
+		SaveThread.join();
+	}
+
+	auto job = std::move(PendingSave);
+	if (job->Succeeded)
+	{
+		savegameManager.NotifyNewSave(job->Filename, job->Description, job->OkForQuicksave, job->ForceQuicksave);
+		BackupSaveName = job->Filename;
+
+		if (longsavemessages) Printf("%s (%s)\n", GStrings("GGSAVED"), job->Filename.GetChars());
+		else Printf("%s\n", GStrings("GGSAVED"));
+	}
+	else
+	{
+		if (job->Error.IsNotEmpty()) Printf(TEXTCOLOR_RED "%s\n", job->Error.GetChars());
+		Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
+	}
+}
+
+//==========================================================================
+//
+// Non-blocking variant of the above, called once per tic.
+//
+//==========================================================================
+
+void G_CheckPendingSave()
+{
+	if (PendingSave != nullptr && PendingSave->Done)
+	{
+		G_WaitForPendingSave();
+	}
+}
+
+void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, const char *description)
+{
 	char buf[100];
 
 	// Do not even try, if we're not in a level. (Can happen after
@@ -2330,6 +2516,9 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		return;
 	}
 
+	// A previous save may still be writing to the same file.
+	G_WaitForPendingSave();
+
 	if (demoplayback)
 	{
 		filename = G_BuildSaveName ("demosave." SAVEGAME_EXT, -1);
@@ -2338,10 +2527,13 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	if (cl_waitforsave)
 		I_FreezeTime(true);
 
+	auto job = std::make_unique<FSaveGameJob>();
+	FString levelsnapshot;
+
 	insave = true;
 	try
 	{
-		level.SnapshotLevel();
+		level.SnapshotLevel(&levelsnapshot);
 	}
 	catch(CRecoverableError &err)
 	{
@@ -2363,7 +2555,6 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		throw;
 	}
 
-	BufferWriter savepic;
 	FSerializer savegameinfo;		// this is for displayable info about the savegame
 	FSerializer savegameglobals;	// and this for non-level related info that must be saved.
 
@@ -2371,13 +2562,15 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 	savegameglobals.OpenWriter(save_formatted);
 
 	SaveVersion = SAVEVER;
-	PutSavePic(&savepic, SAVEPICWIDTH, SAVEPICHEIGHT);
+	PutSavePic(&job->SavePic, SAVEPICWIDTH, SAVEPICHEIGHT);
 	mysnprintf(buf, countof(buf), GAMENAME " %s", GetVersionString());
 	// put some basic info into the PNG so that this isn't lost when the image gets extracted.
-	M_AppendPNGText(&savepic, "Software", buf);
-	M_AppendPNGText(&savepic, "Title", description);
-	M_AppendPNGText(&savepic, "Current Map", primaryLevel->MapName);
-	M_FinishPNG(&savepic);
+	job->PicText.Push("Software");
+	job->PicText.Push(buf);
+	job->PicText.Push("Title");
+	job->PicText.Push(description);
+	job->PicText.Push("Current Map");
+	job->PicText.Push(primaryLevel->MapName);
 
 	int ver = SAVEVER;
 	savegameinfo.AddString("Software", buf)
@@ -2413,61 +2606,51 @@ void G_DoSaveGame (bool okForQuicksave, bool forceQuicksave, FString filename, c
 		savegameglobals("nextskill", NextSkill);
 	}
 
-	auto picdata = savepic.GetBuffer();
-	FCompressedBuffer bufpng = { picdata->Size(), picdata->Size(), METHOD_STORED, 0, static_cast<unsigned int>(crc32(0, &(*picdata)[0], picdata->Size())), (char*)&(*picdata)[0] };
-
-	savegame_content.Push(bufpng);
-	savegame_filenames.Push("savepic.png");
-	savegame_content.Push(savegameinfo.GetCompressedOutput());
-	savegame_filenames.Push("info.json");
-	savegame_content.Push(savegameglobals.GetCompressedOutput());
-	savegame_filenames.Push("globals.json");
-
-	G_WriteSnapshots (savegame_filenames, savegame_content);
-	
+	unsigned len;
+	const char *output;
 
-	bool succeeded = false;
-
-	if (WriteZip(filename, savegame_filenames, savegame_content))
+	// The savepic is encoded by the job, this only reserves its slot.
+	job->Filenames.Push("savepic.png");
+	job->Content.Push({ 0, 0, 0, 0, 0, nullptr });
+	job->RawContent.Push("");
+	output = savegameinfo.GetOutput(&len);
+	job->AddRaw("info.json", FString(output, len));
+	output = savegameglobals.GetOutput(&len);
+	job->AddRaw("globals.json", FString(output, len));
+	if (levelsnapshot.IsNotEmpty())
 	{
-		// Check whether the file is ok by trying to open it.
-		FResourceFile *test = FResourceFile::OpenResourceFile(filename, true);
-		if (test != nullptr)
-		{
-			delete test;
-			succeeded = true;
-		}
+		job->AddRaw(G_SnapshotName(level.info), std::move(levelsnapshot));
 	}
 
-	if (succeeded)
-	{
-		savegameManager.NotifyNewSave(filename, description, okForQuicksave, forceQuicksave);
-		BackupSaveName = filename;
-
-		if (longsavemessages) Printf("%s (%s)\n", GStrings("GGSAVED"), filename.GetChars());
-		else Printf("%s\n", GStrings("GGSAVED"));
-	}
-	else
+	unsigned firstsnapshot = job->Content.Size();
+	G_WriteSnapshots (job->Filenames, job->Content);
+	for (unsigned i = firstsnapshot; i < job->Content.Size(); i++)
 	{
-		Printf(PRINT_HIGH, "%s\n", GStrings("TXT_SAVEFAILED"));
+		job->Content[i] = CopyCompressedBuffer(job->Content[i]);
 	}
+	job->RawContent.Resize(job->Content.Size());
 
+	job->Filename = filename;
+	job->Description = description;
+	job->OkForQuicksave = okForQuicksave;
+	job->ForceQuicksave = forceQuicksave;
 
-	// delete the JSON buffers we created just above. Everything else will
-	// either still be needed or taken care of automatically.
-	savegame_content[1].Clean();
-	savegame_content[2].Clean();
-
-	// We don't need the snapshot any longer.
-	level.info->Snapshot.Clean();
-		
 	insave = false;
 
 	if (cl_waitforsave)
 		I_FreezeTime(false);
-}
-
 
+	PendingSave = std::move(job);
+	if (cl_backgroundsave)
+	{
+		SaveThread = std::thread([job = PendingSave.get()]() { job->Run(); });
+	}
+	else
+	{
+		PendingSave->Run();
+		G_WaitForPendingSave();
+	}
+}
 
 
 //
@@ -2660,6 +2843,8 @@ void G_BeginRecording (const char *startmap)
 	// Begin BODY chunk
 	StartChunk (BODY_ID, &demo_p);
 	demobodyspot = demo_p;
+
+	G_SyncStreamBeginDemo (demoname, true);
 }
 
 
@@ -2936,6 +3121,7 @@ void G_DoPlayDemo (void)
 		usergame = false;
 		demoplayback = true;
 		playedtitlemusic = false;
+		G_SyncStreamBeginDemo (defdemoname, false);
 	}
 }
 
@@ -2980,6 +3166,7 @@ bool G_CheckDemoStatus (void)
 			endtime = I_GetTime () - starttime;
 
 		C_RestoreCVars ();		// [RH] Restore cvars demo might have changed
+		G_SyncStreamEndDemo ();
 		M_Free (demobuffer);
 		demobuffer = NULL;
 
@@ -3000,6 +3187,11 @@ bool G_CheckDemoStatus (void)
 		{
 			if (timingdemo)
 			{
+				if (benchmarking)
+				{
+					G_FinishBenchmark();
+					throw CExitEvent(0);
+				}
 				// Trying to get back to a stable state after timing a demo
 				// seems to cause problems. I don't feel like fixing that
 				// right now.
@@ -3028,6 +3220,7 @@ bool G_CheckDemoStatus (void)
 		uint8_t *formlen;
 
 		WriteByte (DEM_STOP, &demo_p);
+		G_SyncStreamEndDemo ();
 
 		if (demo_compress)
 		{
@@ -66,6 +66,9 @@ void G_SaveGame (const char *filename, const char *description);
 // Called by messagebox
 void G_DoQuickSave ();
 
+// Savegames are written by a background thread. This waits for it to finish.
+void G_WaitForPendingSave ();
+
 // Only called by startup code.
 void G_RecordDemo (const char* name);
 
@@ -1763,26 +1763,34 @@ void FLevelLocals::AirControlChanged ()
 //
 //==========================================================================
 
+FString G_SnapshotName(const level_info_t *info)
+{
+	FString filename;
+	filename.Format("%s.%s.json", info->MapName.GetChars(), info == &TheDefaultLevelInfo ? "mapd" : "map");
+	filename.ToLower();
+	return filename;
+}
+
+//==========================================================================
+//
+//
+//==========================================================================
+
 void G_WriteSnapshots(TArray<FString> &filenames, TArray<FCompressedBuffer> &buffers)
 {
 	unsigned int i;
-	FString filename;
 
 	for (i = 0; i < wadlevelinfos.Size(); i++)
 	{
 		if (wadlevelinfos[i].Snapshot.mCompressedSize > 0)
 		{
-			filename.Format("%s.map.json", wadlevelinfos[i].MapName.GetChars());
-			filename.ToLower();
-			filenames.Push(filename);
+			filenames.Push(G_SnapshotName(&wadlevelinfos[i]));
 			buffers.Push(wadlevelinfos[i].Snapshot);
 		}
 	}
 	if (TheDefaultLevelInfo.Snapshot.mCompressedSize > 0)
 	{
-		filename.Format("%s.mapd.json", TheDefaultLevelInfo.MapName.GetChars());
-		filename.ToLower();
-		filenames.Push(filename);
+		filenames.Push(G_SnapshotName(&TheDefaultLevelInfo));
 		buffers.Push(TheDefaultLevelInfo.Snapshot);
 	}
 }
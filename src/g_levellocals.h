@@ -169,7 +169,7 @@ private:
 	void PlayerSpawnPickClass (int playernum);
 
 public:
-	void SnapshotLevel();
+	void SnapshotLevel(FString *uncompressed = nullptr);
 	void UnSnapshotLevel(bool hubLoad);
 
 	void FinalizePortals();
@@ -52,6 +52,7 @@
 #include "texturemanager.h"
 #include "v_palette.h"
 #include "v_draw.h"
+#include "startuptrace.h"
 
 #define ARTIFLASH_OFFSET (statusBar->invBarOffset+6)
 enum
@@ -441,6 +442,7 @@ void FreeSBarInfoScript()
 
 void SBarInfo::Load()
 {
+	TRACE_SCOPE("SBarInfo::Load");
 	if(gameinfo.statusbar.IsNotEmpty())
 	{
 		int lump = fileSystem.CheckNumForFullName(gameinfo.statusbar, true);
@@ -0,0 +1,647 @@
+/*
+** g_syncstream.cpp
+** Per-tic playsim fingerprints for finding desyncs
+**
+**---------------------------------------------------------------------------
+**
+** This program is free software: you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation, either version 3 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+** GNU General Public License for more details.
+**
+** You should have received a copy of the GNU General Public License
+** along with this program.  If not, see http://www.gnu.org/licenses/
+**
+**---------------------------------------------------------------------------
+**
+*/
+
+#include <string.h>
+#include <stdlib.h>
+#include "g_syncstream.h"
+#include "m_argv.h"
+#include "m_swap.h"
+#include "m_random.h"
+#include "files.h"
+#include "printf.h"
+#include "c_cvars.h"
+#include "c_dispatch.h"
+#include "doomstat.h"
+#include "actor.h"
+#include "g_levellocals.h"
+
+CVAR(Bool, demo_syncstream, false, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
+// Stream layout: the magic, then one record after another. An 'M' record
+// holds the name of the map that the following tics belong to. A 'T'
+// record holds the stream tic, the map time and the section hashes,
+// optionally followed by the details.
+static const char SyncMagic[4] = { 'Z', 'S', 'Y', '1' };
+
+enum ESyncSection
+{
+	SYNC_RNG,
+	SYNC_Actors,
+	SYNC_Sectors,
+
+	NUM_SYNCSECTIONS
+};
+
+static const char *const SyncSectionNames[NUM_SYNCSECTIONS] = { "RNG", "actors", "sectors" };
+
+struct FSyncTic
+{
+	uint32_t Tic;
+	uint32_t Segment;		// index of the map visit this tic belongs to
+	uint32_t MapTime;
+	uint32_t Hashes[NUM_SYNCSECTIONS];
+	bool HasDetail;
+	TArray<uint32_t> RNGs;	// pairs of name CRC and seed
+	TArray<uint32_t> Actors;
+	TArray<FName> ActorClasses;
+	TArray<uint32_t> Sectors;
+};
+
+// A new segment starts whenever the map changes or its time goes back,
+// e.g. when a level gets restarted.
+struct FSyncSegments
+{
+	FString Map;
+	uint32_t MapTime = 0;
+	uint32_t Count = 0;
+
+	// Returns true if the tic starts a new segment.
+	bool Advance(const char *map, uint32_t maptime)
+	{
+		bool newsegment = Count == 0 || Map.CompareNoCase(map) != 0 || maptime < MapTime;
+		if (newsegment)
+		{
+			Map = map;
+			Count++;
+		}
+		MapTime = maptime;
+		return newsegment;
+	}
+};
+
+struct FSyncWriter
+{
+	FileWriter *File = nullptr;
+	uint32_t Tic = 0;
+	FSyncSegments Segments;
+
+	bool Open(const char *filename);
+	void Close();
+	void Write(const FSyncTic &tic, bool detail);
+};
+
+struct FSyncReader
+{
+	FileReader File;
+	FString Name;
+	TArray<FString> Maps;
+	bool Corrupt = false;
+
+	bool Open(const char *filename);
+	bool Next(FSyncTic &tic);
+
+private:
+	bool Has(uint64_t bytes);
+	bool Fail();
+};
+
+static FSyncWriter SessionStream;
+static FSyncWriter DemoStream;
+static FSyncReader DemoCheck;
+static bool DemoChecking;
+static bool HavePending;
+static FSyncTic Pending;
+static FSyncSegments LiveSegments;
+static uint32_t LastMapTime = ~0u;
+static uint32_t DetailFirst = 1, DetailLast = 0;
+
+//==========================================================================
+//
+// Fingerprints
+//
+// Raw bit patterns are hashed, because anything short of identical
+// values would make the runs diverge later.
+//
+//==========================================================================
+
+static inline uint32_t SyncMixInt(uint32_t hash, uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+	{
+		hash = (hash ^ uint8_t(value >> (i * 8))) * 16777619u;
+	}
+	return hash;
+}
+
+static inline uint32_t SyncMixFloat(uint32_t hash, double value)
+{
+	uint64_t bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return SyncMixInt(hash, bits);
+}
+
+static uint32_t HashActor(AActor *ac)
+{
+	uint32_t hash = 2166136261u;
+	hash = SyncMixFloat(hash, ac->X());
+	hash = SyncMixFloat(hash, ac->Y());
+	hash = SyncMixFloat(hash, ac->Z());
+	hash = SyncMixFloat(hash, ac->Vel.X);
+	hash = SyncMixFloat(hash, ac->Vel.Y);
+	hash = SyncMixFloat(hash, ac->Vel.Z);
+	hash = SyncMixInt(hash, ac->Angles.Yaw.BAMs());
+	hash = SyncMixInt(hash, ac->Angles.Pitch.BAMs());
+	hash = SyncMixInt(hash, ac->health);
+	hash = SyncMixInt(hash, ac->flags.GetValue());
+	hash = SyncMixInt(hash, ac->sprite);
+	hash = SyncMixInt(hash, ac->frame);
+	hash = SyncMixInt(hash, ac->tics);
+	return hash;
+}
+
+static uint32_t HashSector(sector_t &sec)
+{
+	uint32_t hash = 2166136261u;
+	hash = SyncMixFloat(hash, sec.floorplane.fD());
+	hash = SyncMixFloat(hash, sec.ceilingplane.fD());
+	hash = SyncMixInt(hash, sec.lightlevel);
+	hash = SyncMixInt(hash, sec.special);
+	return hash;
+}
+
+static void ComputeSyncTic(FSyncTic &tic, bool detail)
+{
+	for (auto &hash : tic.Hashes) hash = 2166136261u;
+	tic.HasDetail = detail;
+	tic.RNGs.Clear();
+	tic.Actors.Clear();
+	tic.ActorClasses.Clear();
+	tic.Sectors.Clear();
+
+	// Nameless RNGs are not part of the game state, see FRandom's constructor.
+	for (auto rng = FRandom::StaticFirstRNG(); rng != nullptr; rng = rng->NextRNG())
+	{
+		if (rng->GetNameCRC() == 0) continue;
+		tic.Hashes[SYNC_RNG] = SyncMixInt(tic.Hashes[SYNC_RNG], rng->GetNameCRC());
+		tic.Hashes[SYNC_RNG] = SyncMixInt(tic.Hashes[SYNC_RNG], (uint32_t)rng->Seed());
+		if (detail)
+		{
+			tic.RNGs.Push(rng->GetNameCRC());
+			tic.RNGs.Push((uint32_t)rng->Seed());
+		}
+	}
+
+	for (auto Level : AllLevels())
+	{
+		auto it = Level->GetThinkerIterator<AActor>();
+		AActor *ac;
+		while ((ac = it.Next()))
+		{
+			uint32_t hash = HashActor(ac);
+			tic.Hashes[SYNC_Actors] = SyncMixInt(tic.Hashes[SYNC_Actors], hash);
+			if (detail)
+			{
+				tic.Actors.Push(hash);
+				tic.ActorClasses.Push(ac->GetClass()->TypeName);
+			}
+		}
+
+		for (auto &sec : Level->sectors)
+		{
+			uint32_t hash = HashSector(sec);
+			tic.Hashes[SYNC_Sectors] = SyncMixInt(tic.Hashes[SYNC_Sectors], hash);
+			if (detail) tic.Sectors.Push(hash);
+		}
+	}
+}
+
+//==========================================================================
+//
+// Writing
+//
+//==========================================================================
+
+static void WriteSyncInt(FileWriter *fw, uint32_t value)
+{
+	value = LittleLong(value);
+	fw->Write(&value, 4);
+}
+
+static void WriteSyncString(FileWriter *fw, const char *str)
+{
+	uint8_t len = (uint8_t)MIN<size_t>(strlen(str), 255);
+	fw->Write(&len, 1);
+	fw->Write(str, len);
+}
+
+bool FSyncWriter::Open(const char *filename)
+{
+	Close();
+	File = FileWriter::Open(filename);
+	if (File == nullptr)
+	{
+		Printf(TEXTCOLOR_RED "Could not write sync stream %s\n", filename);
+		return false;
+	}
+	File->Write(SyncMagic, 4);
+	Tic = 0;
+	Segments = {};
+	return true;
+}
+
+void FSyncWriter::Close()
+{
+	if (File != nullptr) delete File;
+	File = nullptr;
+}
+
+void FSyncWriter::Write(const FSyncTic &tic, bool detail)
+{
+	if (Segments.Advance(primaryLevel->MapName, tic.MapTime))
+	{
+		File->Write("M", 1);
+		WriteSyncString(File, primaryLevel->MapName);
+	}
+
+	File->Write("T", 1);
+	WriteSyncInt(File, Tic);
+	WriteSyncInt(File, tic.MapTime);
+	for (auto hash : tic.Hashes) WriteSyncInt(File, hash);
+
+	uint8_t hasdetail = detail;
+	File->Write(&hasdetail, 1);
+	if (detail)
+	{
+		WriteSyncInt(File, tic.RNGs.Size());
+		for (auto v : tic.RNGs) WriteSyncInt(File, v);
+		WriteSyncInt(File, tic.Actors.Size());
+		for (unsigned i = 0; i < tic.Actors.Size(); i++)
+		{
+			WriteSyncInt(File, tic.Actors[i]);
+			WriteSyncString(File, tic.ActorClasses[i].GetChars());
+		}
+		WriteSyncInt(File, tic.Sectors.Size());
+		for (auto v : tic.Sectors) WriteSyncInt(File, v);
+	}
+	Tic++;
+}
+
+//==========================================================================
+//
+// Reading
+//
+//==========================================================================
+
+bool FSyncReader::Open(const char *filename)
+{
+	char magic[4];
+	Name = filename;
+	Maps.Clear();
+	Corrupt = false;
+	if (!File.OpenFile(filename)) return false;
+	if (File.Read(magic, 4) != 4 || memcmp(magic, SyncMagic, 4))
+	{
+		Printf(TEXTCOLOR_RED "%s is not a sync stream\n", filename);
+		File.Close();
+		return false;
+	}
+	return true;
+}
+
+// Counts in the stream are checked against what is left of the file
+// before anything gets allocated for them.
+bool FSyncReader::Has(uint64_t bytes)
+{
+	return bytes <= uint64_t(File.GetLength() - File.Tell());
+}
+
+bool FSyncReader::Fail()
+{
+	Printf(TEXTCOLOR_RED "%s is truncated or corrupt\n", Name.GetChars());
+	Corrupt = true;
+	File.Close();
+	return false;
+}
+
+bool FSyncReader::Next(FSyncTic &tic)
+{
+	char type;
+	char name[256];
+
+	if (!File.isOpen()) return false;
+	while (File.Read(&type, 1) == 1)
+	{
+		if (type == 'M')
+		{
+			if (!Has(1)) return Fail();
+			uint8_t len = File.ReadUInt8();
+			if (File.Read(name, len) != len) return Fail();
+			name[len] = 0;
+			Maps.Push(name);
+			continue;
+		}
+		if (type != 'T' || Maps.Size() == 0) return Fail();
+		if (!Has(4 * (2 + NUM_SYNCSECTIONS) + 1)) return Fail();
+
+		tic.Tic = File.ReadUInt32();
+		tic.MapTime = File.ReadUInt32();
+		tic.Segment = Maps.Size();
+		for (auto &hash : tic.Hashes) hash = File.ReadUInt32();
+		tic.HasDetail = File.ReadUInt8() != 0;
+		tic.RNGs.Clear();
+		tic.Actors.Clear();
+		tic.ActorClasses.Clear();
+		tic.Sectors.Clear();
+		if (tic.HasDetail)
+		{
+			// Each count is followed by at least the next one.
+			if (!Has(4)) return Fail();
+			unsigned count = File.ReadUInt32();
+			if (!Has(count * 4ull + 4)) return Fail();
+			tic.RNGs.Resize(count);
+			for (auto &v : tic.RNGs) v = File.ReadUInt32();
+
+			// An actor is its hash and a class name of at least its length byte.
+			count = File.ReadUInt32();
+			if (!Has(count * 5ull + 4)) return Fail();
+			tic.Actors.Resize(count);
+			tic.ActorClasses.Resize(count);
+			for (unsigned i = 0; i < count; i++)
+			{
+				if (!Has(5)) return Fail();
+				tic.Actors[i] = File.ReadUInt32();
+				uint8_t len = File.ReadUInt8();
+				if (File.Read(name, len) != len) return Fail();
+				name[len] = 0;
+				tic.ActorClasses[i] = name;
+			}
+
+			if (!Has(4)) return Fail();
+			count = File.ReadUInt32();
+			if (!Has(count * 4ull)) return Fail();
+			tic.Sectors.Resize(count);
+			for (auto &v : tic.Sectors) v = File.ReadUInt32();
+		}
+		return true;
+	}
+	File.Close();
+	return false;
+}
+
+//==========================================================================
+//
+// Reports the first difference between two fingerprints of the same tic.
+//
+//==========================================================================
+
+static void ReportDesync(const FSyncTic &a, const FSyncTic &b, const char *map, const char *namea, const char *nameb)
+{
+	FString sections;
+	for (int i = 0; i < NUM_SYNCSECTIONS; i++)
+	{
+		if (a.Hashes[i] != b.Hashes[i]) sections.AppendFormat("%s%s", sections.IsEmpty() ? "" : ", ", SyncSectionNames[i]);
+	}
+	Printf(TEXTCOLOR_RED "%s and %s desync on %s at map time %u (stream tics %u and %u). Differences in: %s\n",
+		namea, nameb, map, a.MapTime, a.Tic, b.Tic, sections.GetChars());
+
+	if (!a.HasDetail || !b.HasDetail)
+	{
+		Printf("Record both runs with -syncdetail to see what differs.\n");
+		return;
+	}
+
+	if (a.Hashes[SYNC_RNG] != b.Hashes[SYNC_RNG])
+	{
+		unsigned count = MIN(a.RNGs.Size(), b.RNGs.Size());
+		for (unsigned i = 0; i < count; i += 2)
+		{
+			if (a.RNGs[i] != b.RNGs[i] || a.RNGs[i + 1] != b.RNGs[i + 1])
+			{
+				Printf("First differing RNG: #%u, name CRC %08x / %08x, seed %u / %u\n", i / 2, a.RNGs[i], b.RNGs[i], a.RNGs[i + 1], b.RNGs[i + 1]);
+				break;
+			}
+		}
+		if (a.RNGs.Size() != b.RNGs.Size()) Printf("RNG count: %u / %u\n", a.RNGs.Size() / 2, b.RNGs.Size() / 2);
+	}
+	if (a.Hashes[SYNC_Actors] != b.Hashes[SYNC_Actors])
+	{
+		unsigned count = MIN(a.Actors.Size(), b.Actors.Size());
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (a.Actors[i] != b.Actors[i] || a.ActorClasses[i] != b.ActorClasses[i])
+			{
+				Printf("First differing actor: #%u, %s / %s\n", i, a.ActorClasses[i].GetChars(), b.ActorClasses[i].GetChars());
+				break;
+			}
+		}
+		if (a.Actors.Size() != b.Actors.Size()) Printf("Actor count: %u / %u\n", a.Actors.Size(), b.Actors.Size());
+	}
+	if (a.Hashes[SYNC_Sectors] != b.Hashes[SYNC_Sectors])
+	{
+		unsigned count = MIN(a.Sectors.Size(), b.Sectors.Size());
+		for (unsigned i = 0; i < count; i++)
+		{
+			if (a.Sectors[i] != b.Sectors[i])
+			{
+				Printf("First differing sector: #%u\n", i);
+				break;
+			}
+		}
+	}
+}
+
+static bool SyncTicBefore(const FSyncTic &a, uint32_t segment, uint32_t maptime)
+{
+	return a.Segment < segment || (a.Segment == segment && a.MapTime < maptime);
+}
+
+//==========================================================================
+//
+// Compares two streams. Tics are matched by map visit and map time, so
+// streams that started at different points still line up.
+//
+//==========================================================================
+
+bool G_CompareSyncStreams(const char *file1, const char *file2)
+{
+	FSyncReader a, b;
+	FSyncTic ta, tb;
+
+	if (!a.Open(file1) || !b.Open(file2))
+	{
+		Printf(TEXTCOLOR_RED "Could not open the sync streams\n");
+		return false;
+	}
+
+	bool ha = a.Next(ta), hb = b.Next(tb);
+	unsigned compared = 0;
+	while (ha && hb)
+	{
+		if (SyncTicBefore(ta, tb.Segment, tb.MapTime)) ha = a.Next(ta);
+		else if (SyncTicBefore(tb, ta.Segment, ta.MapTime)) hb = b.Next(tb);
+		else
+		{
+			auto &mapa = a.Maps[ta.Segment - 1], &mapb = b.Maps[tb.Segment - 1];
+			if (mapa.CompareNoCase(mapb) != 0)
+			{
+				Printf(TEXTCOLOR_RED "%s is on %s but %s is on %s at map visit %u\n", file1, mapa.GetChars(), file2, mapb.GetChars(), ta.Segment);
+				return false;
+			}
+			if (memcmp(ta.Hashes, tb.Hashes, sizeof(ta.Hashes)))
+			{
+				ReportDesync(ta, tb, mapa, file1, file2);
+				return false;
+			}
+			compared++;
+			ha = a.Next(ta);
+			hb = b.Next(tb);
+		}
+	}
+	if (a.Corrupt || b.Corrupt)
+	{
+		return false;
+	}
+	Printf("%s and %s are in sync (%u tics compared)\n", file1, file2, compared);
+	return true;
+}
+
+CCMD(synccompare)
+{
+	if (argv.argc() < 3)
+	{
+		Printf("Usage: synccompare <stream1> <stream2>\n");
+		return;
+	}
+	G_CompareSyncStreams(argv[1], argv[2]);
+}
+
+//==========================================================================
+//
+// Demo streams
+//
+//==========================================================================
+
+void G_SyncStreamBeginDemo(const char *demoname, bool recording)
+{
+	G_SyncStreamEndDemo();
+	if (!demo_syncstream) return;
+
+	FString filename = demoname;
+	filename << ".sync";
+	if (recording)
+	{
+		DemoStream.Open(filename);
+	}
+	else if (DemoCheck.Open(filename))
+	{
+		DemoChecking = true;
+		HavePending = DemoCheck.Next(Pending);
+		LiveSegments = {};
+		Printf("Checking demo against %s\n", filename.GetChars());
+	}
+}
+
+void G_SyncStreamEndDemo()
+{
+	DemoStream.Close();
+	if (DemoChecking)
+	{
+		DemoCheck.File.Close();
+		DemoChecking = false;
+	}
+}
+
+//==========================================================================
+//
+// Returns true if only streams were compared and the engine should quit.
+//
+//==========================================================================
+
+bool G_InitSyncStream()
+{
+	if (Args->CheckParm("-synccompare"))
+	{
+		int index = Args->CheckParm("-synccompare");
+		if (index + 2 >= Args->NumArgs())
+		{
+			Printf("Usage: -synccompare <stream1> <stream2>\n");
+		}
+		else
+		{
+			G_CompareSyncStreams(Args->GetArg(index + 1), Args->GetArg(index + 2));
+		}
+		return true;
+	}
+
+	const char *detail = Args->CheckValue("-syncdetail");
+	if (detail != nullptr)
+	{
+		char *end;
+		DetailFirst = DetailLast = (uint32_t)strtoul(detail, &end, 10);
+		if (*end == '-') DetailLast = (uint32_t)strtoul(end + 1, nullptr, 10);
+	}
+
+	const char *file = Args->CheckValue("-syncrecord");
+	if (file != nullptr) SessionStream.Open(file);
+	return false;
+}
+
+//==========================================================================
+//
+// Called after every playsim tic.
+//
+//==========================================================================
+
+void G_SyncStreamTic()
+{
+	if (SessionStream.File == nullptr && DemoStream.File == nullptr && !DemoChecking) return;
+
+	// Paused tics do not advance the map time and do not change anything.
+	uint32_t maptime = primaryLevel->maptime;
+	if (maptime == LastMapTime && LiveSegments.Map.CompareNoCase(primaryLevel->MapName) == 0) return;
+	LastMapTime = maptime;
+
+	auto wantdetail = [](FSyncWriter &stream) { return stream.File != nullptr && stream.Tic >= DetailFirst && stream.Tic <= DetailLast; };
+
+	bool newsegment = LiveSegments.Advance(primaryLevel->MapName, maptime);
+	uint32_t segment = LiveSegments.Count;
+	if (DemoChecking)
+	{
+		while (HavePending && SyncTicBefore(Pending, segment, maptime)) HavePending = DemoCheck.Next(Pending);
+		if (!HavePending) DemoChecking = false;
+	}
+	bool checking = DemoChecking && Pending.Segment == segment && Pending.MapTime == maptime;
+
+	FSyncTic tic;
+	ComputeSyncTic(tic, wantdetail(SessionStream) || wantdetail(DemoStream) || (checking && Pending.HasDetail));
+	tic.MapTime = maptime;
+	tic.Segment = segment;
+	tic.Tic = DemoStream.Tic;
+
+	if (SessionStream.File != nullptr) SessionStream.Write(tic, wantdetail(SessionStream));
+	if (DemoStream.File != nullptr) DemoStream.Write(tic, wantdetail(DemoStream));
+
+	if (checking)
+	{
+		if (newsegment && DemoCheck.Maps[segment - 1].CompareNoCase(primaryLevel->MapName) != 0)
+		{
+			Printf(TEXTCOLOR_RED "Demo is on %s but the sync stream is on %s\n", primaryLevel->MapName.GetChars(), DemoCheck.Maps[segment - 1].GetChars());
+			DemoChecking = false;
+		}
+		else if (memcmp(tic.Hashes, Pending.Hashes, sizeof(tic.Hashes)))
+		{
+			ReportDesync(Pending, tic, primaryLevel->MapName, DemoCheck.Name, "this playback");
+			DemoChecking = false;
+		}
+	}
+}
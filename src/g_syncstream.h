@@ -0,0 +1,26 @@
+#pragma once
+
+//==========================================================================
+//
+// Sync streams
+//
+// A sync stream holds a fingerprint of the playsim state for every tic:
+// hashes of all gameplay RNGs, all actors and all sectors. Two runs of
+// the same demo or netgame produce the same stream unless they desync,
+// and comparing the streams gives the first tic that differs. Tics that
+// were recorded with details also hold the individual hashes, which
+// tells which RNG, actor or sector differs.
+//
+// -syncrecord <file>       writes a stream of the whole session.
+// -syncdetail <tic>[-<tic>] records details for these stream tics.
+// -synccompare <a> <b>     compares two streams and quits.
+// demo_syncstream          writes <demo>.sync next to recorded demos and
+//                          checks played back demos against it.
+//
+//==========================================================================
+
+bool G_InitSyncStream();
+void G_SyncStreamBeginDemo(const char *demoname, bool recording);
+void G_SyncStreamEndDemo();
+void G_SyncStreamTic();
+bool G_CompareSyncStreams(const char *file1, const char *file2);
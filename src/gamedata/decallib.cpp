@@ -48,6 +48,7 @@
 #include "g_levellocals.h"
 #include "a_decalfx.h"
 #include "texturemanager.h"
+#include "startuptrace.h"
 
 FDecalLib DecalLibrary;
 
@@ -252,6 +253,7 @@ void FDecalLib::DelTree (FDecalBase *root)
 
 void FDecalLib::ReadAllDecals ()
 {
+	TRACE_SCOPE("FDecalLib::ReadAllDecals");
 	int lump, lastlump = 0;
 	unsigned int i;
 
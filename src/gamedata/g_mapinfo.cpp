@@ -50,6 +50,7 @@
 #include "g_levellocals.h"
 #include "events.h"
 #include "i_system.h"
+#include "startuptrace.h"
 
 static TArray<cluster_info_t> wadclusterinfos;
 TArray<level_info_t> wadlevelinfos;
@@ -2417,6 +2418,7 @@ void G_ClearMapinfo()
 
 void G_ParseMapInfo (FString basemapinfo)
 {
+	TRACE_SCOPE("G_ParseMapInfo");
 	int lump, lastlump = 0;
 	level_info_t gamedefaults;
 
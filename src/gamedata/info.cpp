@@ -53,6 +53,7 @@
 #include "filesystem.h"
 #include "g_levellocals.h"
 #include "texturemanager.h"
+#include "startuptrace.h"
 
 extern void LoadActors ();
 extern void InitBotStuff();
@@ -369,6 +370,7 @@ static void LoadAltHudStuff()
 
 void PClassActor::StaticInit()
 {
+	TRACE_SCOPE("PClassActor::StaticInit");
 	sprites.Clear();
 	if (sprites.Size() == 0)
 	{
@@ -31,6 +31,7 @@
 **
 */
 #include <math.h>
+#include <atomic>
 
 #ifndef _WIN32
 #include <unistd.h>
@@ -60,9 +61,13 @@
 #include "g_levellocals.h"
 #include "i_time.h"
 #include "maploader.h"
+#include "gamestate.h"
+#include "threadpool.h"
 
 EXTERN_CVAR(Bool, gl_cachenodes)
 EXTERN_CVAR(Float, gl_cachetime)
+EXTERN_CVAR(Bool, nb_multithread)
+EXTERN_CVAR(Bool, nb_simd)
 
 // fixed 32 bit gl_vert format v2.0+ (glBsp 1.91)
 struct mapglvertex_t
@@ -1033,6 +1038,25 @@ static void WriteLong(MemFile &f, uint32_t b)
 }
 
 void MapLoader::CreateCachedNodes(MapData *map)
+{
+	uint8_t md5[16];
+	FString error;
+
+	map->GetChecksum(md5);
+	if (!WriteCachedNodes(CreateCacheName(map, true), md5, error))
+	{
+		Printf("%s\n", error.GetChars());
+	}
+}
+
+//==========================================================================
+//
+// Writes the level's nodes to a cache file. This only looks at the
+// level's own data so it can also run on a node cache worker thread.
+//
+//==========================================================================
+
+bool MapLoader::WriteCachedNodes(const FString &path, const uint8_t *md5, FString &error)
 {
 	MemFile ZNodes;
 
@@ -1115,7 +1139,7 @@ void MapLoader::CreateCachedNodes(MapData *map)
 	memcpy(compressed.Data(), "CACH", 4);
 	uint32_t len = LittleLong(Level->lines.Size());
 	memcpy(&compressed[4], &len, 4);
-	map->GetChecksum(&compressed[8]);
+	memcpy(&compressed[8], md5, 16);
 	for (unsigned i = 0; i < Level->lines.Size(); i++)
 	{
 		uint32_t ndx[2] = { LittleLong(uint32_t(Index(Level->lines[i].v1))), LittleLong(uint32_t(Index(Level->lines[i].v2))) };
@@ -1123,48 +1147,67 @@ void MapLoader::CreateCachedNodes(MapData *map)
 	}
 	memcpy(&compressed[offset - 4], "ZGL3", 4);
 
-	FString path = CreateCacheName(map, true);
 	FileWriter *fw = FileWriter::Open(path);
 
 	if (fw != nullptr)
 	{
 		const size_t length = outlen + offset;
-		if (fw->Write(compressed.Data(), length) != length)
+		bool ok = fw->Write(compressed.Data(), length) == length;
+		delete fw;
+		if (!ok)
 		{
-			Printf("Error saving nodes to file %s\n", path.GetChars());
+			error.Format("Error saving nodes to file %s", path.GetChars());
+			return false;
 		}
-		delete fw;
+		return true;
 	}
 	else
 	{
-		Printf("Cannot open nodes file %s for writing\n", path.GetChars());
+		error.Format("Cannot open nodes file %s for writing", path.GetChars());
+		return false;
 	}
 }
 
+//==========================================================================
+//
+// Checks whether a cache file belongs to the given map data.
+// Leaves the reader positioned after the header.
+//
+//==========================================================================
 
-bool MapLoader::CheckCachedNodes(MapData *map)
+static bool CheckCacheHeader(FileReader &fr, uint32_t numlines, const uint8_t *md5map)
 {
 	char magic[4] = {0,0,0,0};
 	uint8_t md5[16];
-	uint8_t md5map[16];
 	uint32_t numlin;
-	TArray<uint32_t> verts;
-
-	FString path = CreateCacheName(map, false);
-	FileReader fr;
-
-	if (!fr.OpenFile(path)) return false;
 
 	if (fr.Read(magic, 4) != 4) return false;
 	if (memcmp(magic, "CACH", 4))  return false;
 
 	if (fr.Read(&numlin, 4) != 4) return false; 
 	numlin = LittleLong(numlin);
-	if (numlin != Level->lines.Size()) return false;
+	if (numlin != numlines) return false;
 
 	if (fr.Read(md5, 16) != 16) return false;
-	map->GetChecksum(md5map);
 	if (memcmp(md5, md5map, 16)) return false;
+	return true;
+}
+
+
+bool MapLoader::CheckCachedNodes(MapData *map)
+{
+	char magic[4] = {0,0,0,0};
+	uint8_t md5map[16];
+	uint32_t numlin = Level->lines.Size();
+	TArray<uint32_t> verts;
+
+	FString path = CreateCacheName(map, false);
+	FileReader fr;
+
+	if (!fr.OpenFile(path)) return false;
+
+	map->GetChecksum(md5map);
+	if (!CheckCacheHeader(fr, numlin, md5map)) return false;
 
 	verts.Resize(numlin * 2);
 	if (fr.Read(verts.Data(), 8 * numlin) != 8 * numlin) return false;
@@ -1225,6 +1268,359 @@ UNSAFE_CCMD(clearnodecache)
 		
 }
 
+//==========================================================================
+//
+// Node cache warming
+//
+// Builds and caches the GL nodes of every map that would otherwise need
+// them built on entry. The maps' geometry is loaded into a scratch level
+// on the game thread, one map per tic; the node builder and writing the
+// cache file run on the thread pool. New maps are only started while no
+// game is in progress, jobs that are already running are allowed to
+// finish.
+//
+//==========================================================================
+
+struct FNodeCacheJob
+{
+	FLevelLocals *Level = nullptr;	// scratch level, owned by the job.
+	TArray<FNodeBuilder::FPolyStart> PolySpots, Anchors;
+	FString MapName;
+	FString Path;
+	uint8_t MD5[16];
+
+	FTaskGroup Task;
+	std::atomic<bool> Done = { false };
+	FString Error;
+
+	~FNodeCacheJob()
+	{
+		// The task must be finished before its level goes away. Run catches
+		// everything, so this does not throw.
+		Task.Wait();
+		delete Level;
+	}
+
+	void Run();
+};
+
+static TArray<FString> NodeCacheQueue;
+static TArray<FNodeCacheJob *> NodeCacheJobs;
+static unsigned NodeCacheMaxJobs;
+static bool NodeCacheActive;
+static int NodeCacheBuilt, NodeCacheValid, NodeCacheSkipped, NodeCacheFailed;
+
+//==========================================================================
+//
+// This runs on a worker thread and must not touch anything but the
+// job's own level.
+//
+//==========================================================================
+
+void FNodeCacheJob::Run()
+{
+	try
+	{
+		FNodeBuilder::FLevel leveldata =
+		{
+			&Level->vertexes[0], (int)Level->vertexes.Size(),
+			&Level->sides[0], (int)Level->sides.Size(),
+			&Level->lines[0], (int)Level->lines.Size(),
+			0, 0, 0, 0
+		};
+		leveldata.FindMapBounds();
+		FNodeBuilder builder(leveldata, PolySpots, Anchors, true);
+		builder.Extract(*Level);
+
+		// Write to a temporary file first so that a map being loaded
+		// at the same time never sees a partially written cache.
+		MapLoader loader(Level);
+		FString temppath = Path + ".tmp";
+		if (loader.WriteCachedNodes(temppath, MD5, Error))
+		{
+			remove(Path.GetChars());
+			if (rename(temppath.GetChars(), Path.GetChars()) != 0)
+			{
+				Error.Format("Cannot rename %s to %s", temppath.GetChars(), Path.GetChars());
+				remove(temppath.GetChars());
+			}
+		}
+	}
+	catch (CEngineError &err)
+	{
+		Error = err.GetMessage();
+	}
+	catch (std::exception &err)
+	{
+		Error = err.what();
+	}
+	catch (...)
+	{
+		Error = "Unknown error";
+	}
+	Done = true;
+}
+
+//==========================================================================
+//
+// Loads a map's geometry and starts a job for it if its cache is
+// missing or out of date.
+//
+//==========================================================================
+
+static void StartNodeCacheJob(const FString &mapname)
+{
+	MapData *map = P_OpenMapData(mapname.GetChars(), true);
+	if (map == nullptr)
+	{
+		NodeCacheSkipped++;
+		return;
+	}
+
+	// Maps that come with GL nodes or extended nodes never use the cache.
+	if (map->Size(ML_GLZNODES) != 0 || map->Size(ML_ZNODES) != 0 || (map->InWad && FindGLNodesInWAD(map->lumpnum) >= 0))
+	{
+		delete map;
+		NodeCacheSkipped++;
+		return;
+	}
+
+	auto job = new FNodeCacheJob;
+	job->MapName = mapname;
+	job->Level = new FLevelLocals;
+	job->Level->info = FindLevelInfo(mapname.GetChars());
+	job->Level->MapName = mapname;
+	job->Level->flags = job->Level->info->flags;
+	job->Level->flags2 = job->Level->info->flags2;
+	job->Level->flags3 = job->Level->info->flags3;
+
+	MapLoader loader(job->Level);
+	bool needed = false;
+	try
+	{
+		needed = loader.LoadNodeBuilderInput(map);
+	}
+	catch (CRecoverableError &err)
+	{
+		Printf("%s: %s\n", mapname.GetChars(), err.GetMessage());
+	}
+
+	if (needed)
+	{
+		map->GetChecksum(job->MD5);
+		FileReader fr;
+		if (fr.OpenFile(CreateCacheName(map, false)) && CheckCacheHeader(fr, job->Level->lines.Size(), job->MD5))
+		{
+			NodeCacheValid++;
+			needed = false;
+		}
+		else
+		{
+			job->Path = CreateCacheName(map, true);
+			loader.GetPolySpots(map, job->PolySpots, job->Anchors);
+		}
+	}
+	else
+	{
+		NodeCacheSkipped++;
+	}
+	delete map;
+
+	if (!needed)
+	{
+		delete job;
+		return;
+	}
+
+	DPrintf(DMSG_NOTIFY, "Building nodes for %s\n", mapname.GetChars());
+	NodeCacheJobs.Push(job);
+	// Without worker threads this builds the nodes right here.
+	job->Task.Run([=]() { job->Run(); });
+}
+
+//==========================================================================
+//
+// Queues the maps whose nodes should be cached. If a pattern is given
+// only the maps whose names match it are considered.
+//
+//==========================================================================
+
+void P_WarmNodeCache(const char *pattern)
+{
+	if (NodeCacheActive)
+	{
+		Printf("Node cache is already being filled\n");
+		return;
+	}
+
+	NodeCacheQueue.Clear();
+	for (auto &info : wadlevelinfos)
+	{
+		if (pattern == nullptr || CheckWildcards(pattern, info.MapName.GetChars()))
+		{
+			if (P_CheckMapData(info.MapName.GetChars()))
+			{
+				NodeCacheQueue.Push(info.MapName);
+			}
+		}
+	}
+	if (NodeCacheQueue.Size() == 0)
+	{
+		Printf("No maps found\n");
+		return;
+	}
+
+	// The node builder can already use several threads on its own.
+	NodeCacheMaxJobs = clamp<unsigned>(ThreadPool::NumWorkers() / 2, 1, 8);
+	NodeCacheBuilt = NodeCacheValid = NodeCacheSkipped = NodeCacheFailed = 0;
+	NodeCacheActive = true;
+	Printf("Caching nodes for %u maps\n", NodeCacheQueue.Size());
+}
+
+//==========================================================================
+//
+// Called once per tic to collect finished jobs and start new ones.
+//
+//==========================================================================
+
+void P_UpdateNodeCacheWarming()
+{
+	if (!NodeCacheActive) return;
+
+	for (unsigned i = 0; i < NodeCacheJobs.Size(); )
+	{
+		auto job = NodeCacheJobs[i];
+		if (!job->Done)
+		{
+			i++;
+			continue;
+		}
+		if (job->Error.IsNotEmpty())
+		{
+			Printf("%s: %s\n", job->MapName.GetChars(), job->Error.GetChars());
+			NodeCacheFailed++;
+		}
+		else
+		{
+			NodeCacheBuilt++;
+		}
+		delete job;
+		NodeCacheJobs.Delete(i);
+	}
+
+	if (NodeCacheQueue.Size() > 0)
+	{
+		if (gamestate != GS_LEVEL && NodeCacheJobs.Size() < NodeCacheMaxJobs)
+		{
+			FString mapname = NodeCacheQueue[0];
+			NodeCacheQueue.Delete(0);
+			StartNodeCacheJob(mapname);
+		}
+	}
+	else if (NodeCacheJobs.Size() == 0)
+	{
+		NodeCacheActive = false;
+		Printf("Node cache: %d built, %d up to date, %d skipped, %d failed\n", NodeCacheBuilt, NodeCacheValid, NodeCacheSkipped, NodeCacheFailed);
+	}
+}
+
+//==========================================================================
+//
+// Drops the queued maps and waits for the running jobs.
+//
+//==========================================================================
+
+void P_StopNodeCacheWarming()
+{
+	NodeCacheQueue.Clear();
+	for (auto job : NodeCacheJobs)
+	{
+		delete job;
+	}
+	NodeCacheJobs.Clear();
+	NodeCacheActive = false;
+}
+
+CCMD(warmnodecache)
+{
+	P_WarmNodeCache(argv.argc() > 1 ? argv[1] : nullptr);
+}
+
+//==========================================================================
+//
+// Rebuilds the current map's nodes with each node builder code path and
+// reports the time taken and whether all paths produced the same tree.
+// Polyobject containers are ignored so the result is not identical to
+// the level's actual nodes.
+//
+//==========================================================================
+
+CCMD(benchnodebuilder)
+{
+	if (primaryLevel->lines.Size() == 0)
+	{
+		Printf("No map loaded\n");
+		return;
+	}
+
+	int count = argv.argc() > 1 ? clamp(atoi(argv[1]), 1, 100) : 3;
+	uint32_t firsthash = 0;
+	bool same = true;
+
+	static const struct { const char *name; bool mt, simd; } modes[] =
+	{
+		{ "scalar", false, false },
+		{ "simd", false, true },
+		{ "threaded", true, false },
+		{ "threaded+simd", true, true },
+	};
+
+	// Puts the user's settings back even if the node builder throws.
+	struct FRestoreSettings
+	{
+		bool mt = nb_multithread;
+		bool simd = nb_simd;
+		~FRestoreSettings()
+		{
+			nb_multithread = mt;
+			nb_simd = simd;
+		}
+	} restore;
+
+	Printf("Building nodes for %s (%u lines), %d runs each\n", primaryLevel->MapName.GetChars(), primaryLevel->lines.Size(), count);
+	for (auto &mode : modes)
+	{
+		uint64_t best = UINT64_MAX;
+		uint32_t hash = 0;
+
+		nb_multithread = mode.mt;
+		nb_simd = mode.simd;
+		for (int i = 0; i < count; i++)
+		{
+			// The node builder overwrites the lines' vertex pointers so it needs a copy.
+			TArray<line_t> lines = primaryLevel->lines;
+			TArray<FNodeBuilder::FPolyStart> polyspots, anchors;
+			FNodeBuilder::FLevel leveldata =
+			{
+				&primaryLevel->vertexes[0], (int)primaryLevel->vertexes.Size(),
+				&primaryLevel->sides[0], (int)primaryLevel->sides.Size(),
+				&lines[0], (int)lines.Size(),
+				0, 0, 0, 0
+			};
+			leveldata.FindMapBounds();
+
+			uint64_t start = I_nsTime();
+			FNodeBuilder builder(leveldata, polyspots, anchors, true);
+			best = MIN(best, I_nsTime() - start);
+			hash = builder.HashTree();
+		}
+		if (&mode == &modes[0]) firsthash = hash;
+		else if (hash != firsthash) same = false;
+		Printf("%-14s %9.3f ms  (hash %08x)\n", mode.name, best / 1e6, hash);
+	}
+	Printf("%s\n", same ? "All code paths produced the same tree." : TEXTCOLOR_RED "Code paths produced different trees!");
+}
+
 //==========================================================================
 //
 // Keep both the original nodes from the WAD and the GL nodes created here.
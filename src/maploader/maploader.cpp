@@ -2776,7 +2776,7 @@ void MapLoader::GroupLines (bool buildmap)
 	}
 
 	// killough 1/30/98: Create xref tables for tags
-	Level->tagManager.HashTags();
+	Level->tagManager.IndexTags();
 
 	if (!buildmap)
 	{
@@ -2934,6 +2934,113 @@ void MapLoader::CalcIndices()
 	}
 }
 
+//==========================================================================
+//
+// Picks the line translator for a Doom format map
+//
+//==========================================================================
+
+void MapLoader::LoadTranslator()
+{
+	const char *translator;
+
+	if (!Level->info->Translator.IsEmpty())
+	{
+		// The map defines its own translator.
+		translator = Level->info->Translator.GetChars();
+	}
+	else
+	{
+		// Has the user overridden the game's default translator with a commandline parameter?
+		translator = Args->CheckValue("-xlat");
+		if (translator == nullptr)
+		{
+			// Use the game's default.
+			translator = gameinfo.translator.GetChars();
+		}
+	}
+	Level->Translator = P_LoadTranslator(translator);
+}
+
+//==========================================================================
+//
+// Loads the map's geometry and things, either from the binary lumps
+// or from a TEXTMAP.
+//
+//==========================================================================
+
+void MapLoader::LoadMapData(MapData *map, FMissingTextureTracker &missingtex)
+{
+	if (!map->isText)
+	{
+		LoadVertexes(map);
+
+		// Check for maps without any BSP data at all (e.g. SLIGE)
+		LoadSectors(map, missingtex);
+
+		if (!map->HasBehavior)
+			LoadLineDefs(map);
+		else
+			LoadLineDefs2(map);	// [RH] Load Hexen-style linedefs
+
+		LoadSideDefs2(map, missingtex);
+
+		FinishLoadingLineDefs();
+
+		if (!map->HasBehavior)
+			LoadThings(map);
+		else
+			LoadThings2(map);	// [RH] Load Hexen-style things
+	}
+	else
+	{
+		ParseTextMap(map, missingtex);
+	}
+}
+
+//==========================================================================
+//
+// Loads only as much of a map as the node builder needs, for filling
+// the node cache without entering the map. The geometry must come out
+// exactly as LoadLevel would produce it, including compatibility fixes,
+// or the cached nodes will not match.
+//
+// Returns false if LoadLevel would always rebuild this map's nodes
+// instead of looking at the cache.
+//
+//==========================================================================
+
+bool MapLoader::LoadNodeBuilderInput(MapData *map)
+{
+	ForceNodeBuild = gennodes;
+
+	if (map->HasBehavior)
+	{
+		Level->maptype = MAPTYPE_HEXEN;
+	}
+	else
+	{
+		LoadTranslator();
+		Level->maptype = MAPTYPE_DOOM;
+	}
+	if (map->isText)
+	{
+		Level->maptype = MAPTYPE_UDMF;
+	}
+	FName checksum = CheckCompatibility(map);
+	if (Level->ib_compatflags & BCOMPATF_REBUILDNODES)
+	{
+		ForceNodeBuild = true;
+	}
+
+	FMissingTextureTracker missingtex;
+
+	LoadMapData(map, missingtex);
+	CalcIndices();
+	PostProcessLevel(checksum);
+	return !ForceNodeBuild && Level->lines.Size() > 0;
+}
+
 //==========================================================================
 //
 //
@@ -2956,24 +3063,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 	else
 	{
 		// We need translators only for Doom format maps.
-		const char *translator;
-
-		if (!Level->info->Translator.IsEmpty())
-		{
-			// The map defines its own translator.
-			translator = Level->info->Translator.GetChars();
-		}
-		else
-		{
-			// Has the user overridden the game's default translator with a commandline parameter?
-			translator = Args->CheckValue("-xlat");
-			if (translator == nullptr)
-			{
-				// Use the game's default.
-				translator = gameinfo.translator.GetChars();
-			}
-		}
-		Level->Translator = P_LoadTranslator(translator);
+		LoadTranslator();
 		Level->maptype = MAPTYPE_DOOM;
 	}
 	if (map->isText)
@@ -3010,32 +3100,7 @@ void MapLoader::LoadLevel(MapData *map, const char *lumpname, int position)
 
 	FMissingTextureTracker missingtex;
 
-	if (!map->isText)
-	{
-		LoadVertexes(map);
-
-		// Check for maps without any BSP data at all (e.g. SLIGE)
-		LoadSectors(map, missingtex);
-
-		if (!map->HasBehavior)
-			LoadLineDefs(map);
-		else
-			LoadLineDefs2(map);	// [RH] Load Hexen-style linedefs
-
-		LoadSideDefs2(map, missingtex);
-
-		FinishLoadingLineDefs();
-
-		if (!map->HasBehavior)
-			LoadThings(map);
-		else
-			LoadThings2(map);	// [RH] Load Hexen-style things
-	}
-	else
-	{
-		ParseTextMap(map, missingtex);
-	}
-
+	LoadMapData(map, missingtex);
 	CalcIndices();
 	PostProcessLevel(checksum);
 
@@ -166,6 +166,8 @@ private:
 	bool LoadNodes(FileReader &lump);
 	bool DoLoadGLNodes(FileReader * lumps);
 	void CreateCachedNodes(MapData *map);
+	void LoadTranslator();
+	void LoadMapData(MapData *map, FMissingTextureTracker &missingtex);
 
 	// Render info
 	void PrepareSectorData();
@@ -279,6 +281,8 @@ public:
 	template<class nodetype, class subsectortype> bool LoadNodes(MapData * map);
 	bool LoadGLNodes(MapData * map);
 	bool CheckCachedNodes(MapData *map);
+	bool WriteCachedNodes(const FString &path, const uint8_t *md5, FString &error);
+	bool LoadNodeBuilderInput(MapData *map);
 	bool CheckNodes(MapData * map, bool rebuilt, int buildtime);
 	bool CheckForGLNodes();
 
@@ -941,9 +941,9 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 		// deep down in the deserializer or just a crash if the few insufficient safeguards were not triggered.
 		uint8_t chk[16] = { 0 };
 		arc.Array("checksum", chk, 16);
-		if (arc.GetSize("linedefs") != lines.Size() ||
-			arc.GetSize("sidedefs") != sides.Size() ||
-			arc.GetSize("sectors") != sectors.Size() ||
+		if (arc.GetSparseSize("linedefs") != lines.Size() ||
+			arc.GetSparseSize("sidedefs") != sides.Size() ||
+			arc.GetSparseSize("sectors") != sectors.Size() ||
 			arc.GetSize("polyobjs") != Polyobjects.Size() ||
 			memcmp(chk, md5, 16))
 		{
@@ -1009,10 +1009,10 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 	Behaviors.SerializeModuleStates(arc);
 	// The order here is important: First world state, then portal state, then thinkers, and last polyobjects.
 	SetCompatLineOnSide(false);	// This flag should not be saved. It solely depends on current compatibility state.
-	arc("linedefs", lines, loadlines);
+	SerializeSparse(arc, "linedefs", lines, loadlines);
 	SetCompatLineOnSide(true);
-	arc("sidedefs", sides, loadsides);
-	arc("sectors", sectors, loadsectors);
+	SerializeSparse(arc, "sidedefs", sides, loadsides);
+	SerializeSparse(arc, "sectors", sectors, loadsectors);
 	arc("zones", Zones);
 	arc("lineportals", linePortals);
 	arc("sectorportals", sectorPortals);
@@ -1072,7 +1072,7 @@ void FLevelLocals::Serialize(FSerializer &arc, bool hubload)
 //
 //==========================================================================
 
-void FLevelLocals::SnapshotLevel()
+void FLevelLocals::SnapshotLevel(FString *uncompressed)
 {
 	info->Snapshot.Clean();
 
@@ -1084,7 +1084,17 @@ void FLevelLocals::SnapshotLevel()
 		{
 			SaveVersion = SAVEVER;
 			Serialize(arc, false);
-			info->Snapshot = arc.GetCompressedOutput();
+			if (uncompressed == nullptr)
+			{
+				info->Snapshot = arc.GetCompressedOutput();
+			}
+			else
+			{
+				// The caller wants to compress the data itself, e.g. on the savegame thread.
+				unsigned len;
+				auto output = arc.GetOutput(&len);
+				*uncompressed = FString(output, len);
+			}
 		}
 	}
 }
@@ -80,6 +80,7 @@
 #include "texturemanager.h"
 #include "p_lnspec.h"
 #include "d_main.h"
+#include "startuptrace.h"
 
 extern AActor *SpawnMapThing (int index, FMapThing *mthing, int position);
 
@@ -610,6 +611,7 @@ void P_SetupLevel(FLevelLocals *Level, int position, bool newGame)
 //
 void P_Init ()
 {
+	TRACE_SCOPE("P_Init");
 	P_InitEffects ();		// [RH]
 	P_InitTerrainTypes ();
 	P_InitKeyMessages ();
@@ -144,6 +144,10 @@ void P_SetupLevel (FLevelLocals *Level, int position, bool newGame);
 
 void P_FreeLevelData();
 
+void P_WarmNodeCache(const char *pattern);
+void P_UpdateNodeCacheWarming();
+void P_StopNodeCacheWarming();
+
 // Called by startup code.
 void P_Init (void);
 
@@ -42,6 +42,7 @@
 #include "v_text.h"
 #include "g_levellocals.h"
 #include "a_dynlight.h"
+#include "g_benchmark.h"
 
 
 static int ThinkCount;
@@ -105,6 +106,7 @@ void FThinkerCollection::RunThinkers(FLevelLocals *Level)
 	BotWTG = 0;
 
 	ThinkCycles.Clock();
+	FBenchClock benchclock(BENCH_Thinkers);
 
 	if (!profilethinkers)
 	{
@@ -78,6 +78,7 @@
 #include "s_music.h"
 #include "v_video.h"
 #include "texturemanager.h"
+#include "g_benchmark.h"
 
 	// P-codes for ACS scripts
 	enum
@@ -3415,6 +3416,7 @@ void DACSThinker::Tick ()
 {
 	ACSTime.Reset();
 	ACSTime.Clock();
+	FBenchClock benchclock(BENCH_Scripts);
 	DLevelScript *script = Scripts;
 
 	while (script)
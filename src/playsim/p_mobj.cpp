@@ -99,6 +99,7 @@
 #include "actorinlines.h"
 #include "a_dynlight.h"
 #include "fragglescript/t_fs.h"
+#include "g_benchmark.h"
 
 // MACROS ------------------------------------------------------------------
 
@@ -1794,6 +1795,7 @@ bool P_SeekerMissile (AActor *actor, double thresh, double turnMax, bool precise
 
 double P_XYMovement (AActor *mo, DVector2 scroll) 
 {
+	FBenchClock benchclock(BENCH_Movement);
 	static int pushtime = 0;
 	bool bForceSlide = !scroll.isZero();
 	DVector2 ptry;
@@ -2373,6 +2375,7 @@ void P_MonsterFallingDamage (AActor *mo)
 
 void P_ZMovement (AActor *mo, double oldfloorz)
 {
+	FBenchClock benchclock(BENCH_Movement);
 	double dist;
 	double delta;
 	double oldz = mo->Z();
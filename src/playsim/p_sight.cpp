@@ -36,6 +36,7 @@
 
 #include "g_levellocals.h"
 #include "actorinlines.h"
+#include "g_benchmark.h"
 
 static FRandom pr_botchecksight ("BotCheckSight");
 static FRandom pr_checksight ("CheckSight");
@@ -841,6 +842,7 @@ sightcounts[2]++;
 int P_CheckSight (AActor *t1, AActor *t2, int flags)
 {
 	SightCycles.Clock();
+	FBenchClock benchclock(BENCH_Sight);
 
 	bool res;
 
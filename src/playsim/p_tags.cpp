@@ -34,11 +34,98 @@
 */
 
 
+#include <algorithm>
 #include "p_tags.h"
 #include "c_dispatch.h"
 #include "g_levellocals.h"
 #include "vm.h"
 
+// The end marker that IndexTags appends to allTags and allIDs.
+static const FTagItem EndMarker = { -1, -1 };
+
+//-----------------------------------------------------------------------------
+//
+// Returns the position of the first entry with the given tag in a sorted
+// index, or of the first one with a higher tag if there is none.
+//
+//-----------------------------------------------------------------------------
+
+static unsigned LowerBound(const TArray<FTagItem> &index, int tag)
+{
+	auto found = std::lower_bound(index.Data(), index.Data() + index.Size(), tag,
+		[](const FTagItem &item, int tag) { return item.tag < tag; });
+	return unsigned(found - index.Data());
+}
+
+static unsigned UpperBound(const TArray<FTagItem> &index, int tag)
+{
+	auto found = std::upper_bound(index.Data(), index.Data() + index.Size(), tag,
+		[](int tag, const FTagItem &item) { return tag < item.tag; });
+	return unsigned(found - index.Data());
+}
+
+//-----------------------------------------------------------------------------
+//
+//
+//
+//-----------------------------------------------------------------------------
+
+int FTagManager::FindSectorTag(int tag) const
+{
+	return LowerBound(sectorsByTag, tag);
+}
+
+int FTagManager::FindLineID(int id) const
+{
+	return LowerBound(linesByID, id);
+}
+
+//-----------------------------------------------------------------------------
+//
+// Appends a new entry to allTags or allIDs. Once the index has been built
+// the end marker has to stay last, and the entry goes to the end of its
+// tag's run in the index, which is where IndexTags would have put it.
+//
+//-----------------------------------------------------------------------------
+
+void FTagManager::AddItem(TArray<FTagItem> &items, TArray<FTagItem> &index, const FTagItem &item)
+{
+	if (!indexed)
+	{
+		items.Push(item);
+	}
+	else
+	{
+		items.Insert(items.Size() - 1, item);
+		index.Insert(UpperBound(index, item.tag), item);
+	}
+}
+
+//-----------------------------------------------------------------------------
+//
+// Invalidates the run of entries for one target that starts at 'start'.
+//
+//-----------------------------------------------------------------------------
+
+void FTagManager::RemoveItems(TArray<FTagItem> &items, TArray<FTagItem> &index, int start, int target)
+{
+	for (unsigned i = start; i < items.Size() && items[i].target == target; i++)
+	{
+		if (indexed)
+		{
+			for (unsigned j = LowerBound(index, items[i].tag); j < index.Size() && index[j].tag == items[i].tag; j++)
+			{
+				if (index[j].target == target)
+				{
+					index.Delete(j);
+					break;
+				}
+			}
+		}
+		items[i].tag = items[i].target = -1;
+	}
+}
+
 //-----------------------------------------------------------------------------
 //
 //
@@ -57,7 +144,7 @@ void FTagManager::AddSectorTag(int sector, int tag)
 	}
 	if (startForSector[sector] == -1)
 	{
-		startForSector[sector] = allTags.Size();
+		startForSector[sector] = indexed ? allTags.Size() - 1 : allTags.Size();	// in front of the end marker
 	}
 	else
 	{
@@ -70,8 +157,8 @@ void FTagManager::AddSectorTag(int sector, int tag)
 			}
 		}
 	}
-	FTagItem it = { sector, tag, -1 };
-	allTags.Push(it);
+	FTagItem it = { sector, tag };
+	AddItem(allTags, sectorsByTag, it);
 }
 
 //-----------------------------------------------------------------------------
@@ -87,11 +174,7 @@ void FTagManager::RemoveSectorTags(int sect)
 		int start = startForSector[sect];
 		if (start >= 0)
 		{
-			while (allTags[start].target == sect)
-			{
-				allTags[start].tag = allTags[start].target = -1;
-				start++;
-			}
+			RemoveItems(allTags, sectorsByTag, start, sect);
 		}
 	}
 }
@@ -109,11 +192,7 @@ void FTagManager::RemoveLineIDs(int line)
 		int start = startForLine[line];
 		if (start >= 0)
 		{
-			while (allIDs[start].target == line)
-			{
-				allTags[start].tag = allTags[start].target = -1;
-				start++;
-			}
+			RemoveItems(allIDs, linesByID, start, line);
 		}
 	}
 }
@@ -135,7 +214,7 @@ void FTagManager::AddLineID(int line, int tag)
 	}
 	if (startForLine[line] == -1)
 	{
-		startForLine[line] = allIDs.Size();
+		startForLine[line] = indexed ? allIDs.Size() - 1 : allIDs.Size();	// in front of the end marker
 	}
 	else
 	{
@@ -148,8 +227,8 @@ void FTagManager::AddLineID(int line, int tag)
 			}
 		}
 	}
-	FTagItem it = { line, tag, -1 };
-	allIDs.Push(it);
+	FTagItem it = { line, tag };
+	AddItem(allIDs, linesByID, it);
 }
 
 //-----------------------------------------------------------------------------
@@ -158,38 +237,26 @@ void FTagManager::AddLineID(int line, int tag)
 //
 //-----------------------------------------------------------------------------
 
-void FTagManager::HashTags()
+void FTagManager::IndexTags()
 {
 	// add an end marker so we do not need to check for the array's size in the other functions.
-	static FTagItem it = { -1, -1, -1 };
-	allTags.Push(it);
-	allIDs.Push(it);
-
-	// Initially make all slots empty.
-	memset(TagHashFirst, -1, sizeof(TagHashFirst));
-	memset(IDHashFirst, -1, sizeof(IDHashFirst));
+	allTags.Push(EndMarker);
+	allIDs.Push(EndMarker);
 
-	// Proceed from last to first so that lower targets appear first
-	for (int i = allTags.Size() - 1; i >= 0; i--)
+	// The sort has to be stable so that the targets of each tag stay in the order they were added in.
+	auto build = [](const TArray<FTagItem> &items, TArray<FTagItem> &index)
 	{
-		if (allTags[i].target >= 0)	// only link valid entries
+		index.Clear();
+		for (auto &item : items)
 		{
-			int hash = ((unsigned int)allTags[i].tag) % FTagManager::TAG_HASH_SIZE;
-			allTags[i].nexttag = TagHashFirst[hash];
-			TagHashFirst[hash] = i;
+			if (item.target >= 0) index.Push(item);	// only index valid entries
 		}
-	}
-
-	for (int i = allIDs.Size() - 1; i >= 0; i--)
-	{
-		if (allIDs[i].target >= 0)	// only link valid entries
-		{
-			int hash = ((unsigned int)allIDs[i].tag) % FTagManager::TAG_HASH_SIZE;
-			allIDs[i].nexttag = IDHashFirst[hash];
-			IDHashFirst[hash] = i;
-		}
-	}
-
+		std::stable_sort(index.Data(), index.Data() + index.Size(),
+			[](const FTagItem &a, const FTagItem &b) { return a.tag < b.tag; });
+	};
+	build(allTags, sectorsByTag);
+	build(allIDs, linesByID);
+	indexed = true;
 }
 
 //-----------------------------------------------------------------------------
@@ -319,7 +386,8 @@ void FTagManager::DumpTags()
 // RETURN NEXT SECTOR # THAT LINE TAG REFERS TO
 //
 // Find the next sector with a specified tag.
-// Rewritten by Lee Killough to use chained hashing to improve speed
+// Rewritten by Lee Killough to use chained hashing to improve speed.
+// Now a walk over the tag's run in the sorted index.
 //
 //-----------------------------------------------------------------------------
 
@@ -333,10 +401,9 @@ int FSectorTagIterator::Next()
 	}
 	else if (searchtag != 0)
 	{
-		while (start >= 0 && tagManager.allTags[start].tag != searchtag) start = tagManager.allTags[start].nexttag;
-		if (start == -1) return -1;
-		ret = tagManager.allTags[start].target;
-		start = tagManager.allTags[start].nexttag;
+		auto &index = tagManager.sectorsByTag;
+		if ((unsigned)start >= index.Size() || index[start].tag != searchtag) return -1;
+		ret = index[start++].target;
 	}
 	else
 	{
@@ -378,10 +445,8 @@ int FSectorTagIterator::NextCompat(bool compat, int start)
 
 int FLineIdIterator::Next()
 {
-	while (start >= 0 && tagManager.allIDs[start].tag != searchtag) start = tagManager.allIDs[start].nexttag;
-	if (start == -1) return -1;
-	int ret = tagManager.allIDs[start].target;
-	start = tagManager.allIDs[start].nexttag;
-	return ret;
+	auto &index = tagManager.linesByID;
+	if ((unsigned)start >= index.Size() || index[start].tag != searchtag) return -1;
+	return index[start++].target;
 }
 
@@ -8,7 +8,6 @@ struct FTagItem
 {
 	int target;		// either sector or line
 	int tag;
-	int nexttag;	// for hashing
 };
 
 class FSectorTagIterator;
@@ -17,11 +16,6 @@ struct FLevelLocals;
 
 class FTagManager
 {
-	enum
-	{
-		TAG_HASH_SIZE = 256
-	};
-
 	// Only the iterators and the map loader, including its helpers may access this. Everything else should go through FLevelLocals's interface.
 	friend class FSectorTagIterator;
 	friend class FLineIdIterator;
@@ -34,8 +28,14 @@ class FTagManager
 	TArray<FTagItem> allIDs;
 	TArray<int> startForSector;
 	TArray<int> startForLine;
-	int TagHashFirst[TAG_HASH_SIZE];
-	int IDHashFirst[TAG_HASH_SIZE];
+
+	// The valid entries of allTags and allIDs sorted by tag, so that the
+	// iterators can walk all targets of a tag in one contiguous run. Within
+	// a tag they keep the order of allTags/allIDs. Built by IndexTags and
+	// updated in place by any changes that come after it.
+	TArray<FTagItem> sectorsByTag;
+	TArray<FTagItem> linesByID;
+	bool indexed = false;
 
 	bool SectorHasTags(int sect) const
 	{
@@ -55,8 +55,9 @@ class FTagManager
 		allIDs.Clear();
 		startForSector.Clear();
 		startForLine.Clear();
-		memset(TagHashFirst, -1, sizeof(TagHashFirst));
-		memset(IDHashFirst, -1, sizeof(IDHashFirst));
+		sectorsByTag.Clear();
+		linesByID.Clear();
+		indexed = false;
 	}
 
 	bool SectorHasTags(const sector_t *sector) const;
@@ -69,7 +70,13 @@ class FTagManager
 	bool LineHasID(int line, int id) const;
 	bool LineHasID(const line_t *line, int id) const;
 
-	void HashTags();
+	int FindSectorTag(int tag) const;
+	int FindLineID(int id) const;
+
+	void AddItem(TArray<FTagItem> &items, TArray<FTagItem> &index, const FTagItem &item);
+	void RemoveItems(TArray<FTagItem> &items, TArray<FTagItem> &index, int start, int target);
+
+	void IndexTags();
 public:	// The ones below are called by functions that cannot be declared as friend.
 	void AddSectorTag(int sector, int tag);
 	void AddLineID(int line, int tag);
@@ -95,7 +102,7 @@ protected:
 	void Init(int tag)
 	{
 		searchtag = tag;
-		start = tag == 0 ? 0 : tagManager.TagHashFirst[((unsigned int)tag) % FTagManager::TAG_HASH_SIZE];
+		start = tag == 0 ? 0 : tagManager.FindSectorTag(tag);
 	}
 
 	void Init(int tag, line_t *line)
@@ -108,7 +115,7 @@ protected:
 		else
 		{
 			searchtag = tag;
-			start = tagManager.TagHashFirst[((unsigned int)tag) % FTagManager::TAG_HASH_SIZE];
+			start = tagManager.FindSectorTag(tag);
 		}
 	}
 
@@ -138,7 +145,7 @@ protected:
 	FLineIdIterator(FTagManager &tm, int id) : tagManager(tm)
 	{
 		searchtag = id;
-		start = tagManager.IDHashFirst[((unsigned int)id) % FTagManager::TAG_HASH_SIZE];
+		start = tagManager.FindLineID(id);
 	}
 
 public:
@@ -48,6 +48,7 @@
 #include "hwrenderer/postprocessing/hw_postprocessshader.h"
 #include "hw_material.h"
 #include "texturemanager.h"
+#include "startuptrace.h"
 
 void AddLightDefaults(FLightDefaults *defaults, double attnFactor);
 void AddLightAssociation(const char *actor, const char *frame, const char *light);
@@ -1853,6 +1854,7 @@ void LoadGLDefs(const char *defsLump)
 
 void ParseGLDefs()
 {
+	TRACE_SCOPE("ParseGLDefs");
 	const char *defsLump = NULL;
 
 	LightDefaults.DeleteAndClear();
@@ -183,7 +183,7 @@ sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bou
 	return mainvp.sector;
 }
 
-void DoWriteSavePic(FileWriter* file, ESSType ssformat, uint8_t* scr, int width, int height, sector_t* viewsector, bool upsidedown)
+void DoWriteSavePic(FPNGCapture* capture, ESSType ssformat, uint8_t* scr, int width, int height, sector_t* viewsector, bool upsidedown)
 {
 	PalEntry palette[256];
 	PalEntry modulateColor;
@@ -230,7 +230,7 @@ void DoWriteSavePic(FileWriter* file, ESSType ssformat, uint8_t* scr, int width,
 		pitch *= -1;
 	}
 
-	M_CreatePNG(file, scr, ssformat == SS_PAL ? palette : nullptr, ssformat, width, height, pitch, vid_gamma);
+	capture->Capture(scr, ssformat == SS_PAL ? palette : nullptr, ssformat, width, height, pitch, vid_gamma);
 }
 
 //===========================================================================
@@ -239,11 +239,11 @@ void DoWriteSavePic(FileWriter* file, ESSType ssformat, uint8_t* scr, int width,
 //
 //===========================================================================
 
-void WriteSavePic(player_t* player, FileWriter* file, int width, int height)
+void WriteSavePic(player_t* player, FPNGCapture* capture, int width, int height)
 {
 	if (!V_IsHardwareRenderer())
 	{
-		SWRenderer->WriteSavePic(player, file, width, height);
+		SWRenderer->WriteSavePic(player, capture, width, height);
 	}
 	else
 	{
@@ -277,7 +277,7 @@ void WriteSavePic(player_t* player, FileWriter* file, int width, int height)
 		uint8_t* scr = (uint8_t*)M_Malloc(numpixels * 3);
 		screen->CopyScreenToBuffer(width, height, scr);
 
-		DoWriteSavePic(file, SS_RGB, scr, width, height, viewsector, screen->FlipSavePic());
+		DoWriteSavePic(capture, SS_RGB, scr, width, height, viewsector, screen->FlipSavePic());
 		M_Free(scr);
 
 		// Switch back the screen render buffers
@@ -301,6 +301,8 @@ static void CheckTimer(FRenderState &state, uint64_t ShaderStartTime)
 }
 
 
+void hw_ContinuePrecache();
+
 sector_t* RenderView(player_t* player)
 {
 	auto RenderState = screen->RenderState();
@@ -326,6 +328,9 @@ sector_t* RenderView(player_t* player)
 		// reset statistics counters
 		ResetProfilingData();
 
+		// Create some more of the textures the precacher has queued up.
+		hw_ContinuePrecache();
+
 		// Get this before everything else
 		if (cl_capfps || r_NoInterpolate) r_viewpoint.TicFrac = 1.;
 		else r_viewpoint.TicFrac = I_GetTimeFrac();
@@ -40,8 +40,23 @@
 #include "modelrenderer.h"
 #include "hw_models.h"
 #include "d_main.h"
+#include "i_time.h"
+#include "parallel_for.h"
+#include <thread>
 
 EXTERN_CVAR(Bool, gl_precache)
+CVAR(Int, gl_precache_budget, 0, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)	// > 0: stream the precached textures in, spending at most this many ms per frame.
+
+// Materials waiting to be created by the precacher.
+struct FPrecacheItem
+{
+	FGameTexture *tex;
+	int scaleflags;
+	int translation;
+};
+
+static TArray<FPrecacheItem> PrecacheQueue;
+static unsigned PrecachePos;
 
 //==========================================================================
 //
@@ -56,36 +71,171 @@ static void PrecacheTexture(FGameTexture *tex, int cache)
 		int scaleflags = 0;
 		if (shouldUpscale(tex, UF_Texture)) scaleflags |= CTF_Upscale;
 
-		FMaterial * gltex = FMaterial::ValidateTexture(tex, scaleflags);
-		if (gltex) screen->PrecacheMaterial(gltex, 0);
+		PrecacheQueue.Push({ tex, scaleflags, 0 });
 	}
 }
 
-//===========================================================================
-//
+//==========================================================================
 //
+// DFrameBuffer :: PrecacheSprite
 //
-//===========================================================================
-static void PrecacheList(FMaterial *gltex, SpriteHits& translations)
+//==========================================================================
+
+static void PrecacheSprite(FGameTexture *tex, SpriteHits &hits)
 {
-	SpriteHits::Iterator it(translations);
+	int scaleflags = CTF_Expand;
+	if (shouldUpscale(tex, UF_Sprite)) scaleflags |= CTF_Upscale;
+
+	SpriteHits::Iterator it(hits);
 	SpriteHits::Pair* pair;
-	while (it.NextPair(pair)) screen->PrecacheMaterial(gltex, pair->Key);
+	while (it.NextPair(pair)) PrecacheQueue.Push({ tex, scaleflags, pair->Key });
 }
 
 //==========================================================================
 //
-// DFrameBuffer :: PrecacheSprite
+// Creates the materials of a part of the queue.
+//
+// Decoding the images has to be done here because the image sources
+// read from the shared file system and image caches, but upscaling
+// works on the decoded buffers alone, so all buffers of the batch that
+// need it are upscaled in parallel first. The backend then picks the
+// finished buffers up when it creates the hardware textures.
 //
 //==========================================================================
 
-static void PrecacheSprite(FGameTexture *tex, SpriteHits &hits)
+static void PrecacheBatch(unsigned first, unsigned last)
 {
-	int scaleflags = CTF_Expand;
-	if (shouldUpscale(tex, UF_Sprite)) scaleflags |= CTF_Upscale;
+	struct FBufferJob
+	{
+		FTexture *tex;
+		int translation;
+		int flags;
+		bool transparent;
+	};
+
+	TArray<std::pair<FMaterial*, int>> materials;
+	TArray<FBufferJob> jobs;
+
+	for (unsigned i = first; i < last; i++)
+	{
+		auto &item = PrecacheQueue[i];
+		FMaterial *mat = FMaterial::ValidateTexture(item.tex, item.scaleflags);
+		if (mat == nullptr) continue;
+		materials.Push(std::make_pair(mat, item.translation));
+
+		// Indexed materials are never upscaled.
+		if (mat->GetScaleFlags() & CTF_Indexed) continue;
+
+		auto &layers = mat->GetLayerArray();
+		for (unsigned l = 0; l < layers.Size(); l++)
+		{
+			auto tex = layers[l].layerTexture;
+			int translation = l == 0 ? item.translation : 0;
+			int flags = layers[l].scaleFlags | CTF_ProcessData;
+
+			if (tex == nullptr || tex->isHardwareCanvas() || tex->GetImage() == nullptr || !(flags & CTF_Upscale)) continue;
+
+			auto hwtex = tex->SystemTextures.GetHardwareTexture(translation, layers[l].scaleFlags);
+			if (hwtex != nullptr && hwtex->IsCreated()) continue;
+
+			bool found = false;
+			for (auto &job : jobs)
+			{
+				if (job.tex == tex && job.translation == translation && job.flags == flags) found = true;
+			}
+			if (!found) jobs.Push({ tex, translation, flags, false });
+		}
+	}
+
+	TArray<FTextureBuffer> buffers;
+	buffers.Resize(jobs.Size());
+	for (unsigned j = 0; j < jobs.Size(); j++)
+	{
+		buffers[j] = jobs[j].tex->CreateRawTexBuffer(jobs[j].translation, jobs[j].flags, jobs[j].transparent);
+	}
+
+	parallel_for((int)jobs.Size(), [&](int j)
+	{
+		jobs[j].tex->UpscaleTexBuffer(buffers[j], jobs[j].transparent, jobs[j].flags);
+	});
+
+	for (unsigned j = 0; j < jobs.Size(); j++)
+	{
+		jobs[j].tex->FinishTexBuffer(buffers[j], jobs[j].flags);
+		jobs[j].tex->StorePreparedBuffer(jobs[j].translation, jobs[j].flags, std::move(buffers[j]));
+	}
+
+	for (auto &mat : materials)
+	{
+		screen->PrecacheMaterial(mat.first, mat.second);
+	}
 
-	FMaterial * gltex = FMaterial::ValidateTexture(tex, scaleflags);
-	if (gltex) PrecacheList(gltex, hits);
+	// Anything the backend did not ask for is not needed anymore.
+	for (auto &job : jobs)
+	{
+		job.tex->ClearPreparedBuffers();
+	}
+}
+
+//==========================================================================
+//
+// Works through the queue. With a budget, this stops once the
+// given time has been spent and continues on the next call.
+//
+//==========================================================================
+
+static void ProcessPrecacheQueue(uint64_t budgetns)
+{
+	uint64_t start = I_nsTime();
+	unsigned batchsize = std::max(std::thread::hardware_concurrency(), 1u);
+
+	while (PrecachePos < PrecacheQueue.Size())
+	{
+		if (budgetns > 0 && I_nsTime() - start >= budgetns) return;
+
+		unsigned last = std::min(PrecachePos + batchsize, PrecacheQueue.Size());
+		PrecacheBatch(PrecachePos, last);
+		PrecachePos = last;
+	}
+
+	if (PrecacheQueue.Size() > 0)
+	{
+		PrecacheQueue.Reset();
+		PrecachePos = 0;
+		FImageSource::EndPrecaching();
+	}
+}
+
+//==========================================================================
+//
+// Called once per frame by the hardware renderer while textures are
+// being streamed in. Whatever gets drawn before it has been processed
+// is created on demand as usual.
+//
+//==========================================================================
+
+void hw_ContinuePrecache()
+{
+	if (PrecachePos < PrecacheQueue.Size())
+	{
+		ProcessPrecacheQueue(std::max(*gl_precache_budget, 1) * 1000000ull);
+	}
+}
+
+//==========================================================================
+//
+// Drops the rest of a previous level's queue.
+//
+//==========================================================================
+
+static void ClearPrecacheQueue()
+{
+	if (PrecacheQueue.Size() > 0)
+	{
+		PrecacheQueue.Reset();
+		PrecachePos = 0;
+		FImageSource::EndPrecaching();
+	}
 }
 
 
@@ -100,6 +250,8 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 	TMap<FTexture*, bool> allTextures;
 	TArray<FTexture*> layers;
 
+	ClearPrecacheQueue();
+
 	// First collect the potential max. texture set 
 	for (int i = 1; i < TexMan.NumTextures(); i++)
 	{
@@ -313,8 +465,9 @@ void hw_PrecacheTexture(uint8_t *texhitlist, TMap<PClassActor*, bool> &actorhitl
 			}
 		}
 
-
-		FImageSource::EndPrecaching();
+		if (PrecacheQueue.Size() == 0) FImageSource::EndPrecaching();
+		// Without a budget everything gets created right now. Otherwise the renderer will do it over the next frames.
+		else if (gl_precache_budget <= 0) ProcessPrecacheQueue(0);
 
 		// cache all used models
 		FModelRenderer* renderer = new FHWModelRenderer(nullptr, *screen->RenderState(), -1);
@@ -27,6 +27,7 @@ class HWSprite;
 struct HWDecal;
 class IShadowMap;
 struct particle_t;
+struct FPNGCapture;
 struct FDynLightData;
 struct HUDSprite;
 class Clipper;
@@ -341,7 +342,7 @@ public:
 
 void CleanSWDrawer();
 sector_t* RenderViewpoint(FRenderViewpoint& mainvp, AActor* camera, IntRect* bounds, float fov, float ratio, float fovratio, bool mainview, bool toscreen);
-void WriteSavePic(player_t* player, FileWriter* file, int width, int height);
+void WriteSavePic(player_t* player, FPNGCapture* capture, int width, int height);
 sector_t* RenderView(player_t* player);
 
 
@@ -65,6 +65,7 @@
 #include "g_game.h"
 #include "i_system.h"
 #include "v_draw.h"
+#include "startuptrace.h"
 
 // EXTERNAL DATA DECLARATIONS ----------------------------------------------
 
@@ -393,6 +394,7 @@ FRenderer* SWRenderer;
 
 void R_Init ()
 {
+	TRACE_SCOPE("R_Init");
 	StartScreen->Progress();
 	R_InitTranslationTables ();
 	R_SetViewSize (screenblocks);
@@ -11,7 +11,7 @@ class AActor;
 class player_t;
 struct sector_t;
 class FCanvasTexture;
-class FileWriter;
+struct FPNGCapture;
 class DCanvas;
 struct FLevelLocals;
 class PClassActor;
@@ -27,7 +27,7 @@ struct FRenderer
 	virtual void RenderView(player_t *player, DCanvas *target, void *videobuffer, int bufferpitch) = 0;
 
 	// renders view to a savegame picture
-	virtual void WriteSavePic(player_t *player, FileWriter *file, int width, int height) = 0;
+	virtual void WriteSavePic(player_t *player, FPNGCapture *capture, int width, int height) = 0;
 
 	// draws player sprites with hardware acceleration (only useful for software rendering)
 	virtual void DrawRemainingPlayerSprites() = 0;
@@ -198,9 +198,9 @@ void FSoftwareRenderer::RenderView(player_t *player, DCanvas *target, void *vide
 	});
 }
 
-void DoWriteSavePic(FileWriter *file, ESSType ssformat, uint8_t *scr, int width, int height, sector_t *viewsector, bool upsidedown);
+void DoWriteSavePic(FPNGCapture *capture, ESSType ssformat, uint8_t *scr, int width, int height, sector_t *viewsector, bool upsidedown);
 
-void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int width, int height)
+void FSoftwareRenderer::WriteSavePic (player_t *player, FPNGCapture *capture, int width, int height)
 {
 	DCanvas pic(width, height, false);
 
@@ -211,7 +211,7 @@ void FSoftwareRenderer::WriteSavePic (player_t *player, FileWriter *file, int wi
 	r_viewpoint = mScene.MainThread()->Viewport->viewpoint;
 	r_viewwindow = mScene.MainThread()->Viewport->viewwindow;
 
-	DoWriteSavePic(file, SS_PAL, pic.GetPixels(), width, height, r_viewpoint.sector, false);
+	DoWriteSavePic(capture, SS_PAL, pic.GetPixels(), width, height, r_viewpoint.sector, false);
 }
 
 void FSoftwareRenderer::DrawRemainingPlayerSprites()
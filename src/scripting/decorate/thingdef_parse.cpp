@@ -52,6 +52,7 @@
 #ifndef _MSC_VER
 #include "i_system.h"  // for strlwr()
 #endif // !_MSC_VER
+#include "startuptrace.h"
 
 void ParseOldDecoration(FScanner &sc, EDefinitionType def, PNamespace *ns);
 EXTERN_CVAR(Bool, strictdecorate);
@@ -1356,6 +1357,7 @@ void ParseDecorate (FScanner &sc, PNamespace *ns)
 
 void ParseAllDecorate()
 {
+	TRACE_SCOPE("ParseAllDecorate");
 	int lastlump = 0, lump;
 
 	while ((lump = fileSystem.FindLump("DECORATE", &lastlump)) != -1)
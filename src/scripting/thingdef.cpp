@@ -55,6 +55,7 @@
 #include "thingdef.h"
 #include "zcc_parser.h"
 #include "zcc_compile_doom.h"
+#include "startuptrace.h"
 
 // EXTERNAL FUNCTION PROTOTYPES --------------------------------------------
 void InitThingdef();
@@ -412,6 +413,7 @@ void SetDoomCompileEnvironment();
 
 void ParseScripts()
 {
+	TRACE_SCOPE("ParseScripts");
 	int lump, lastlump = 0;
 	FScriptPosition::ResetErrorCounter();
 
@@ -440,6 +442,7 @@ void ParseScripts()
 
 void LoadActors()
 {
+	TRACE_SCOPE("LoadActors");
 	cycle_t timer;
 
 	timer.Reset(); timer.Clock();
@@ -57,6 +57,7 @@
 #include "a_dynlight.h"
 #include "types.h"
 #include "dictionary.h"
+#include "startuptrace.h"
 
 static TArray<FPropertyInfo*> properties;
 static TArray<AFuncDesc> AFTable;
@@ -629,6 +630,7 @@ void InitImports();
 
 void InitThingdef()
 {
+	TRACE_SCOPE("InitThingdef");
 	// Some native types need size and serialization information added before the scripts get compiled.
 	auto secplanestruct = NewStruct("Secplane", nullptr, true);
 	secplanestruct->Size = sizeof(secplane_t);
@@ -66,6 +66,8 @@
 #include "g_game.h"
 #include "s_music.h"
 #include "v_draw.h"
+#include "startuptrace.h"
+#include "g_benchmark.h"
 
 // PUBLIC DATA DEFINITIONS -------------------------------------------------
 
@@ -221,6 +223,7 @@ static FileReader OpenMusic(const char* musicname)
 
 void S_Init()
 {
+	TRACE_SCOPE("S_Init");
 	// Hook up the music player with the engine specific customizations.
 	static MusicCallbacks cb = { LookupMusic, OpenMusic };
 	S_SetMusicCallbacks(&cb);
@@ -385,6 +388,7 @@ void S_PrecacheLevel(FLevelLocals* Level)
 
 void S_InitData()
 {
+	TRACE_SCOPE("S_InitData");
 	LastLocalSndInfo = LastLocalSndSeq = "";
 	S_ParseSndInfo(false);
 	S_ParseSndSeq(-1);
@@ -806,6 +810,7 @@ static void S_SetListener(AActor *listenactor)
 
 void S_UpdateSounds (AActor *listenactor)
 {
+	FBenchClock benchclock(BENCH_Sound);
 	// should never happen
 	S_SetListener(listenactor);
 	
@@ -902,6 +907,7 @@ void S_SerializeSounds(FSerializer &arc)
 			{
 				chan = (FSoundChan*)soundEngine->GetChannel(nullptr);
 				arc(nullptr, *chan);
+				soundEngine->IndexChannel(chan);
 				// Sounds always start out evicted when restored from a save.
 				chan->ChanFlags |= CHANF_EVICTED | CHANF_ABSTIME;
 			}
@@ -43,11 +43,20 @@
 
 #include "doomdata.h"
 #include "nodebuild.h"
+#include "c_cvars.h"
+#include "parallel_for.h"
 
 const int MaxSegs = 64;
 const int SplitCost = 8;
 const int AAPreference = 16;
 
+// Splitter candidates are only scored in parallel if the number of
+// candidates times the number of segs in the set exceeds this.
+const int ParallelWork = 1 << 16;
+
+CVAR(Bool, nb_multithread, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+CVAR(Bool, nb_simd, true, CVAR_ARCHIVE | CVAR_GLOBALCONFIG)
+
 #if 0
 #define D(x) x
 #else
@@ -55,7 +64,7 @@ const int AAPreference = 16;
 #endif
 
 FNodeBuilder::FNodeBuilder(FLevel &lev)
-: Level(lev), GLNodes(false), SegsStuffed(0)
+: PackedSet(UINT_MAX), Level(lev), GLNodes(false), SegsStuffed(0)
 {
 	VertexMap = NULL;
 	OldVertexTable = NULL;
@@ -64,7 +73,7 @@ FNodeBuilder::FNodeBuilder(FLevel &lev)
 FNodeBuilder::FNodeBuilder (FLevel &lev,
 							TArray<FPolyStart> &polyspots, TArray<FPolyStart> &anchors,
 							bool makeGLNodes)
-	: Level(lev), GLNodes(makeGLNodes), SegsStuffed(0)
+	: PackedSet(UINT_MAX), Level(lev), GLNodes(makeGLNodes), SegsStuffed(0)
 {
 	VertexMap = new FVertexMap (*this, Level.MinX, Level.MinY, Level.MaxX, Level.MaxY);
 	FindUsedVertices (Level.Vertices, Level.NumVertices);
@@ -428,9 +437,35 @@ bool FNodeBuilder::ShoveSegBehind (uint32_t set, node_t &node, uint32_t seg, uin
 		node.dx = -node.dx;
 		node.dy = -node.dy;
 	}
+	PackSet (set);
 	return Heuristic (node, set, false) > 0;
 }
 
+// Copies the set's seg numbers and vertex coordinates into flat arrays in
+// list order. The heuristic works on these instead of walking the list.
+
+void FNodeBuilder::PackSet (uint32_t set)
+{
+	PackedSet = set;
+	PackedSegs.Clear();
+	PackedX1.Clear();
+	PackedY1.Clear();
+	PackedX2.Clear();
+	PackedY2.Clear();
+
+	for (uint32_t seg = set; seg != UINT_MAX; seg = Segs[seg].next)
+	{
+		const FPrivVert &v1 = Vertices[Segs[seg].v1];
+		const FPrivVert &v2 = Vertices[Segs[seg].v2];
+
+		PackedSegs.Push(seg);
+		PackedX1.Push(double(v1.x));
+		PackedY1.Push(double(v1.y));
+		PackedX2.Push(double(v2.x));
+		PackedY2.Push(double(v2.y));
+	}
+}
+
 // Splitters are chosen to coincide with segs in the given set. To reduce the
 // number of segs that need to be considered as splitters, segs are grouped into
 // according to the planes that they lie on. Because one seg on the plane is just
@@ -445,6 +480,7 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	uint32_t bestseg;
 	uint32_t seg;
 	bool nosplitters = false;
+	int segsInSet = 0;
 
 	bestvalue = 0;
 	bestseg = UINT_MAX;
@@ -453,9 +489,13 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 	stepleft = 0;
 
 	memset (&PlaneChecked[0], 0, PlaneChecked.Size());
+	Candidates.Clear();
+	PackSet (set);
 
 	D(Printf (PRINT_LOG, "Processing set %d\n", set));
 
+	// Which segs are tried as splitters does not depend on their scores,
+	// so they can be collected first and scored independently.
 	while (seg != UINT_MAX)
 	{
 		FPrivSeg *pseg = &Segs[seg];
@@ -473,31 +513,62 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 				}
 
 				stepleft = step;
-				SetNodeFromSeg (node, pseg);
+				Candidates.Push (seg);
+			}
+		}
 
-				int value = Heuristic (node, set, nosplit);
+		seg = pseg->next;
+	}
+	segsInSet = PackedSegs.Size();
 
-				D(Printf (PRINT_LOG, "Seg %5d, ld %d (%5d,%5d)-(%5d,%5d) scores %d\n", seg, Segs[seg].linedef, node.x>>16, node.y>>16,
-					(node.x+node.dx)>>16, (node.y+node.dy)>>16, value));
+	CandidateValues.Resize (Candidates.Size());
+	if (nb_multithread && Candidates.Size() > 1 && (int64_t)Candidates.Size() * segsInSet >= ParallelWork)
+	{
+		parallel_for ((int)Candidates.Size(), [&](int i)
+		{
+			node_t testnode;
+			TArray<int> touched, colinear;
 
-				if (value > bestvalue)
-				{
-					bestvalue = value;
-					bestseg = seg;
-				}
-				else if (value < 0)
-				{
-					nosplitters = true;
-				}
-			}
+			SetNodeFromSeg (testnode, &Segs[Candidates[i]]);
+			CandidateValues[i] = Heuristic (testnode, set, nosplit, touched, colinear);
+		});
+	}
+	else
+	{
+		for (unsigned i = 0; i < Candidates.Size(); ++i)
+		{
+			SetNodeFromSeg (node, &Segs[Candidates[i]]);
+			CandidateValues[i] = Heuristic (node, set, nosplit);
 		}
+	}
 
-		seg = pseg->next;
+	// Pick the best one in the same order as scoring them serially would
+	// so that the resulting tree does not depend on the number of threads.
+	for (unsigned i = 0; i < Candidates.Size(); ++i)
+	{
+		int value = CandidateValues[i];
+
+		D(Printf (PRINT_LOG, "Seg %5d, ld %d scores %d\n", Candidates[i], Segs[Candidates[i]].linedef, value));
+
+		if (value > bestvalue)
+		{
+			bestvalue = value;
+			bestseg = Candidates[i];
+		}
+		else if (value < 0)
+		{
+			nosplitters = true;
+		}
 	}
 
 	if (bestseg == UINT_MAX)
 	{ // No lines split any others into two sets, so this is a convex region.
 	D(Printf (PRINT_LOG, "set %d, step %d, nosplit %d has no good splitter (%d)\n", set, step, nosplit, nosplitters));
+		if (Candidates.Size() > 0)
+		{
+			// Leave the node set up like the serial version did.
+			SetNodeFromSeg (node, &Segs[Candidates.Last()]);
+		}
 		return nosplitters ? -1 : 0;
 	}
 
@@ -515,6 +586,14 @@ int FNodeBuilder::SelectSplitter (uint32_t set, node_t &node, uint32_t &splitseg
 // in the set.
 
 int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
+{
+	return Heuristic (node, set, honorNoSplit, Touched, Colinear);
+}
+
+// This version can run on multiple threads at once because it only
+// reads the builder's state and keeps its bookkeeping in the passed arrays.
+
+int FNodeBuilder::Heuristic (const node_t &node, uint32_t set, bool honorNoSplit, TArray<int> &touched, TArray<int> &colinear) const
 {
 	// Set the initial score above 0 so that near vertex anti-weighting is less likely to produce a negative score.
 	int score = 1000000;
@@ -522,27 +601,70 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	int counts[2] = { 0, 0 };
 	int realSegs[2] = { 0, 0 };
 	int specialSegs[2] = { 0, 0 };
-	uint32_t i = set;
 	int sidev[2];
 	int side;
 	bool splitter = false;
 	unsigned int max, m2, p, q;
 	double frac;
+	int8_t codes[CLASSIFY_BATCH];
+	const unsigned int numsegs = PackedSegs.Size();
+#ifdef NB_HAVE_AVX2
+	const bool batched = nb_simd && CPU.bAVX2 && CPU.bOSAVX;
+#else
+	const bool batched = false;
+#endif
 
-	Touched.Clear ();
-	Colinear.Clear ();
+	assert (set == PackedSet);
 
-	while (i != UINT_MAX)
+	touched.Clear ();
+	colinear.Clear ();
+
+	for (unsigned int k = 0; k < numsegs; ++k)
 	{
+		const uint32_t i = PackedSegs[k];
 		const FPrivSeg *test = &Segs[i];
+		int code = CLASSIFY_EXACT;
+
+		if (batched)
+		{
+			if (k % CLASSIFY_BATCH == 0)
+			{
+				ClassifyLinesAVX2 (node, &PackedX1[k], &PackedY1[k], &PackedX2[k], &PackedY2[k], MIN<unsigned>(numsegs - k, CLASSIFY_BATCH), codes);
+			}
+			code = codes[k % CLASSIFY_BATCH];
+		}
 
 		if (HackSeg == i)
 		{
 			side = 1;
 		}
-		else
+		else switch (code)
 		{
+		case CLASSIFY_FRONT:
+			sidev[0] = sidev[1] = -1;
+			side = 0;
+			break;
+
+		case CLASSIFY_BACK:
+			sidev[0] = sidev[1] = 1;
+			side = 1;
+			break;
+
+		case CLASSIFY_CUT_FB:
+			sidev[0] = -1;
+			sidev[1] = 1;
+			side = -1;
+			break;
+
+		case CLASSIFY_CUT_BF:
+			sidev[0] = 1;
+			sidev[1] = -1;
+			side = -1;
+			break;
+
+		default:
 			side = ClassifyLine (node, &Vertices[test->v1], &Vertices[test->v2], sidev);
+			break;
 		}
 		switch (side)
 		{
@@ -556,32 +678,32 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 			{
 				if ((sidev[0] | sidev[1]) != 0)
 				{
-					max = Touched.Size();
+					max = touched.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Touched[p] == test->loopnum)
+						if (touched[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Touched.Push (test->loopnum);
+						touched.Push (test->loopnum);
 					}
 				}
 				else
 				{
-					max = Colinear.Size();
+					max = colinear.Size();
 					for (p = 0; p < max; ++p)
 					{
-						if (Colinear[p] == test->loopnum)
+						if (colinear[p] == test->loopnum)
 						{
 							break;
 						}
 					}
 					if (p == max)
 					{
-						Colinear.Push (test->loopnum);
+						colinear.Push (test->loopnum);
 					}
 				}
 			}
@@ -663,7 +785,6 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 		}
 
 		segsInSet++;
-		i = test->next;
 	}
 
 	// If this line is outside all the others, return a special score
@@ -698,8 +819,8 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 	// seg of that sector must be crossing the container's corner and does not
 	// actually split the container.
 
-	max = Touched.Size ();
-	m2 = Colinear.Size ();
+	max = touched.Size ();
+	m2 = colinear.Size ();
 
 	// If honorNoSplit is false, then both these lists will be empty.
 
@@ -712,10 +833,10 @@ int FNodeBuilder::Heuristic (node_t &node, uint32_t set, bool honorNoSplit)
 
 	for (p = 0; p < max; ++p)
 	{
-		int look = Touched[p];
+		int look = touched[p];
 		for (q = 0; q < m2; ++q)
 		{
-			if (look == Colinear[q])
+			if (look == colinear[q])
 			{
 				break;
 			}
@@ -1033,7 +1154,7 @@ void FNodeBuilder::RemoveSegFromVert2 (uint32_t segnum, int vertnum)
 	}
 }
 
-double FNodeBuilder::InterceptVector (const node_t &splitter, const FPrivSeg &seg)
+double FNodeBuilder::InterceptVector (const node_t &splitter, const FPrivSeg &seg) const
 {
 	double v2x = (double)Vertices[seg.v1].x;
 	double v2y = (double)Vertices[seg.v1].y;
@@ -45,6 +45,12 @@ struct FPolySeg;
 struct FMiniBSP;
 struct FLevelLocals;
 
+// The AVX2 classifier is only used where its results are known to match the
+// scalar code bit for bit, i.e. where doubles are not computed on the x87.
+#if defined(__amd64__) || defined(_M_X64)
+#define NB_HAVE_AVX2
+#endif
+
 struct FEventInfo
 {
 	int Vertex;
@@ -244,6 +250,9 @@ public:
 	void BuildMini(bool makeGLNodes);
 	void ExtractMini(FMiniBSP *bsp);
 
+	// Used to verify that different code paths produce the same tree.
+	uint32_t HashTree() const;
+
 	static angle_t PointToAngle (fixed_t dx, fixed_t dy);
 
 	//  < 0 : in front of line
@@ -267,6 +276,14 @@ private:
 
 	TArray<int> Touched;	// Loops a splitter touches on a vertex
 	TArray<int> Colinear;	// Loops with edges colinear to a splitter
+	TArray<uint32_t> Candidates;	// Segs tried as splitters by SelectSplitter
+	TArray<int> CandidateValues;	// and their scores
+
+	// The seg set being examined by the heuristic, with its endpoints
+	// packed into separate arrays so that they can be classified in batches.
+	uint32_t PackedSet;
+	TArray<uint32_t> PackedSegs;
+	TArray<double> PackedX1, PackedY1, PackedX2, PackedY2;
 	FEventTree Events;		// Vertices intersected by the current splitter
 
 	TArray<FSplitSharer> SplitSharers;	// Segs colinear with the current splitter
@@ -298,13 +315,29 @@ private:
 	void SplitSegs (uint32_t set, node_t &node, uint32_t splitseg, uint32_t &outset0, uint32_t &outset1, unsigned int &count0, unsigned int &count1);
 	uint32_t SplitSeg (uint32_t segnum, int splitvert, int v1InFront);
 	int Heuristic (node_t &node, uint32_t set, bool honorNoSplit);
+	int Heuristic (const node_t &node, uint32_t set, bool honorNoSplit, TArray<int> &touched, TArray<int> &colinear) const;
 
 	// Returns:
 	//	0 = seg is in front
 	//  1 = seg is in back
 	// -1 = seg cuts the node
 
-	int ClassifyLine (node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2]);
+	static int ClassifyLine (const node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2]);
+
+	// Classifies a batch of packed segs. Only segs that are far enough from
+	// the splitter get a definite result, all others are marked for ClassifyLine.
+	enum
+	{
+		CLASSIFY_BATCH = 8,
+
+		CLASSIFY_FRONT = 0,		// both vertices in front
+		CLASSIFY_BACK,			// both vertices behind
+		CLASSIFY_CUT_FB,		// v1 in front, v2 behind
+		CLASSIFY_CUT_BF,		// v1 behind, v2 in front
+		CLASSIFY_EXACT			// too close, needs ClassifyLine
+	};
+	static void ClassifyLinesAVX2 (const node_t &node, const double *x1, const double *y1, const double *x2, const double *y2, unsigned count, int8_t *codes);
+	void PackSet (uint32_t set);
 
 	void FixSplitSharers (const node_t &node);
 	double AddIntersection (const node_t &node, int vertex);
@@ -323,7 +356,7 @@ private:
 
 	static int SortSegs (const void *a, const void *b);
 
-	double InterceptVector (const node_t &splitter, const FPrivSeg &seg);
+	double InterceptVector (const node_t &splitter, const FPrivSeg &seg) const;
 
 	void PrintSet (int l, uint32_t set);
 
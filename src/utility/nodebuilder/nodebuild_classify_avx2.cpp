@@ -0,0 +1,74 @@
+/*
+** nodebuild_classify_avx2.cpp
+**
+** Batched seg classification for the node builder's splitter heuristic.
+**
+** This file is compiled with AVX2 enabled and must only be called after
+** checking the CPU. It must not be compiled with FMA contraction so that
+** the products are rounded exactly like the scalar code in
+** nodebuild_classify_nosse2.cpp.
+**
+*/
+
+#include "doomtype.h"
+#include "nodebuild.h"
+
+#ifdef NB_HAVE_AVX2
+
+#include <immintrin.h>
+
+#define FAR_ENOUGH 17179869184.f		// 4<<32
+
+void FNodeBuilder::ClassifyLinesAVX2(const node_t &node, const double *x1, const double *y1, const double *x2, const double *y2, unsigned count, int8_t *codes)
+{
+	const __m256d d_x1 = _mm256_set1_pd(double(node.x));
+	const __m256d d_y1 = _mm256_set1_pd(double(node.y));
+	const __m256d d_dx = _mm256_set1_pd(double(node.dx));
+	const __m256d d_dy = _mm256_set1_pd(double(node.dy));
+	const __m256d far_pos = _mm256_set1_pd(FAR_ENOUGH);
+	const __m256d far_neg = _mm256_set1_pd(-FAR_ENOUGH);
+
+	unsigned i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		__m256d xv1 = _mm256_loadu_pd(x1 + i);
+		__m256d yv1 = _mm256_loadu_pd(y1 + i);
+		__m256d xv2 = _mm256_loadu_pd(x2 + i);
+		__m256d yv2 = _mm256_loadu_pd(y2 + i);
+
+		// s_num = (d_y1 - yv) * d_dx - (d_x1 - xv) * d_dy, exactly as ClassifyLine does it.
+		__m256d s_num1 = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(d_y1, yv1), d_dx), _mm256_mul_pd(_mm256_sub_pd(d_x1, xv1), d_dy));
+		__m256d s_num2 = _mm256_sub_pd(_mm256_mul_pd(_mm256_sub_pd(d_y1, yv2), d_dx), _mm256_mul_pd(_mm256_sub_pd(d_x1, xv2), d_dy));
+
+		int back1 = _mm256_movemask_pd(_mm256_cmp_pd(s_num1, far_neg, _CMP_LE_OQ));
+		int front1 = _mm256_movemask_pd(_mm256_cmp_pd(s_num1, far_pos, _CMP_GE_OQ));
+		int back2 = _mm256_movemask_pd(_mm256_cmp_pd(s_num2, far_neg, _CMP_LE_OQ));
+		int front2 = _mm256_movemask_pd(_mm256_cmp_pd(s_num2, far_pos, _CMP_GE_OQ));
+
+		for (int j = 0; j < 4; j++)
+		{
+			int bit = 1 << j;
+			int8_t code = CLASSIFY_EXACT;
+
+			if (back1 & bit)
+			{
+				if (back2 & bit) code = CLASSIFY_BACK;
+				else if (front2 & bit) code = CLASSIFY_CUT_BF;
+			}
+			else if (front1 & bit)
+			{
+				if (front2 & bit) code = CLASSIFY_FRONT;
+				else if (back2 & bit) code = CLASSIFY_CUT_FB;
+			}
+			codes[i + j] = code;
+		}
+	}
+
+	// Let ClassifyLine handle the few remaining ones.
+	for (; i < count; i++)
+	{
+		codes[i] = CLASSIFY_EXACT;
+	}
+}
+
+#endif
@@ -3,7 +3,7 @@
 
 #define FAR_ENOUGH 17179869184.f		// 4<<32
 
-int FNodeBuilder::ClassifyLine(node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2])
+int FNodeBuilder::ClassifyLine(const node_t &node, const FPrivVert *v1, const FPrivVert *v2, int sidev[2])
 {
 	double d_x1 = double(node.x);
 	double d_y1 = double(node.y);
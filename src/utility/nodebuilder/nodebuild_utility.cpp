@@ -103,6 +103,40 @@ void FNodeBuilder::FindUsedVertices (vertex_t *oldverts, int max)
 	OldVertexTable = map;
 }
 
+// Computes a hash over the built tree that only depends on the output,
+// so that the results of different code paths can be compared.
+
+uint32_t FNodeBuilder::HashTree() const
+{
+	uint32_t hash = 2166136261u;
+	auto add = [&](int64_t val)
+	{
+		for (int i = 0; i < 8; ++i, val >>= 8)
+		{
+			hash = (hash ^ uint32_t(val & 255)) * 16777619u;
+		}
+	};
+
+	for (auto &node : Nodes)
+	{
+		add(node.x); add(node.y); add(node.dx); add(node.dy);
+		add(node.intchildren[0]); add(node.intchildren[1]);
+	}
+	for (auto &seg : Segs)
+	{
+		add(seg.v1); add(seg.v2); add(seg.linedef); add(seg.partner);
+	}
+	for (auto &vert : Vertices)
+	{
+		add(vert.x); add(vert.y);
+	}
+	for (auto set : SubsectorSets)
+	{
+		add(set);
+	}
+	return hash;
+}
+
 // Retrieves the original vertex -> current vertex table.
 // Doing so prevents the node builder from freeing it.
 